@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+enum class ActivationType {
+    Identity,
+    Sigmoid,
+    ReLU,
+    Tanh
+};
+
+// Exact: Sigmoid/Tanh go through std::exp/std::tanh, results are bit-identical on every kernel.
+// Fast: polynomial exp (degree 7 on a ln2/2 range). Max absolute error is below 2e-9 for
+// Sigmoid and 4e-9 for Tanh over the whole real line; ReLU and Identity are always exact.
+// Every kernel runs the same unfused multiplies and adds as fastmath::exp, so Fast results are
+// bit-identical on every kernel too, vector lanes and scalar tail alike.
+enum class ActivationMode {
+    Exact,
+    Fast
+};
+
+void setActivationMode(ActivationMode mode);
+
+ActivationMode getActivationMode();
+
+// Name of the array kernel picked for this CPU at startup: "avx2", "sse2" or "scalar".
+const char *getActivationKernelName();
+
+// Applies the activation in place to n contiguous values using the current mode.
+void activateArray(ActivationType activationType, double *values, size_t n);
+
+inline double applyActivation(ActivationType activationType, double input) {
+    switch (activationType) {
+        case ActivationType::Identity:
+            return input;
+        case ActivationType::Sigmoid:
+            return 1.0 / (1.0 + std::exp(-input));
+        case ActivationType::ReLU:
+            return input > 0 ? input : 0;
+        case ActivationType::Tanh:
+            return std::tanh(input);
+        default:
+            return input;
+    }
+}
+
+namespace fastmath {
+    constexpr double Log2e = 1.4426950408889634;
+    constexpr double Ln2 = 0.6931471805599453;
+    constexpr double RoundMagic = 6755399441055744.0;  // 2^52 + 2^51, rounds to nearest integer
+    constexpr double ExpLimit = 80.0;
+    constexpr double TanhLimit = 20.0;                  // tanh(20) == 1 in double precision
+    constexpr double SigmoidLimit = 40.0;
+
+    // e^x for |x| <= ExpLimit: x = n*ln2 + g, e^g by Horner, 2^n spliced into the exponent bits
+    inline double exp(double x) {
+        x = std::fmin(std::fmax(x, -ExpLimit), ExpLimit);
+        double shifted = x * Log2e + RoundMagic;
+        double n = shifted - RoundMagic;
+        double g = x - n * Ln2;
+        double p = 1.0 / 5040.0;
+        p = p * g + 1.0 / 720.0;
+        p = p * g + 1.0 / 120.0;
+        p = p * g + 1.0 / 24.0;
+        p = p * g + 1.0 / 6.0;
+        p = p * g + 0.5;
+        p = p * g + 1.0;
+        p = p * g + 1.0;
+        uint64_t bits;
+        std::memcpy(&bits, &shifted, sizeof(bits));
+        bits = (bits + 1023) << 52;
+        double scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return p * scale;
+    }
+
+    inline double tanh(double x) {
+        x = std::fmin(std::fmax(x, -TanhLimit), TanhLimit);
+        return 1.0 - 2.0 / (exp(2.0 * x) + 1.0);
+    }
+
+    inline double sigmoid(double x) {
+        x = std::fmin(std::fmax(x, -SigmoidLimit), SigmoidLimit);
+        return 1.0 / (1.0 + exp(-x));
+    }
+}
+
+inline double applyActivation(ActivationType activationType, double input, ActivationMode mode) {
+    if (mode == ActivationMode::Fast) {
+        if (activationType == ActivationType::Sigmoid) return fastmath::sigmoid(input);
+        if (activationType == ActivationType::Tanh) return fastmath::tanh(input);
+    }
+    return applyActivation(activationType, input);
+}
+
+inline float applyActivation(ActivationType activationType, float input, ActivationMode mode) {
+    if (mode == ActivationMode::Fast)
+        return static_cast<float>(applyActivation(activationType, static_cast<double>(input), mode));
+
+    switch (activationType) {
+        case ActivationType::Sigmoid:
+            return 1.0f / (1.0f + std::exp(-input));
+        case ActivationType::ReLU:
+            return input > 0 ? input : 0;
+        case ActivationType::Tanh:
+            return std::tanh(input);
+        default:
+            return input;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <Model/Phenotype.h>
+
+struct BatchStats {
+    int genomes = 0;
+    int buckets = 0;        // distinct topologies with more than one genome
+    int singletons = 0;     // genomes evaluated on their own
+    double meanBucketSize = 0.0;
+};
+
+// Evaluates one input row per genome for a whole population at once. Genomes with
+// identical topology share a bucket whose weights are packed edge-major, so each
+// edge becomes one multiply-add over all lanes of the bucket. Buckets compute in double,
+// so only Double phenotypes are accepted and a genome's outputs never depend on which
+// other genomes share its topology.
+class BatchEvaluator {
+public:
+    // Groups the phenotypes by topology and packs their parameters. The phenotypes must be
+    // Double and stay alive and unchanged until the next assign().
+    void assign(const std::vector<Phenotype *> &phenotypes);
+
+    // inputs: one row of getInputCount() values per assigned phenotype,
+    // outputs: one row of getOutputCount() values per assigned phenotype.
+    // Rows whose active flag is 0 are skipped (their outputs are left untouched).
+    void evaluate(const double *inputs, double *outputs, const uint8_t *active = nullptr);
+
+    [[nodiscard]] const BatchStats &getStats() const { return stats_; }
+
+private:
+    struct Bucket {
+        const Phenotype *shape = nullptr;
+        std::vector<int> members{};
+        std::vector<double> weight{};   // [edge][lane]
+        std::vector<double> bias{};     // [computed node][lane]
+        std::vector<double> seed{};     // [computed node][lane]
+        std::vector<double> values{};   // [slot][lane], constant slots filled by assign()
+    };
+
+    std::vector<Phenotype *> phenotypes_{};
+    std::vector<Bucket> buckets_{};
+    std::vector<int> singletons_{};
+    std::vector<double> rowIn_{}, rowOut_{};
+    int inputCount_{0}, outputCount_{0};
+    BatchStats stats_{};
+
+    void evaluateBucket(Bucket &bucket, const double *inputs, double *outputs, const uint8_t *active);
+};
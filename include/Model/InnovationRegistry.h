@@ -0,0 +1,50 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <Utils/RandomUtils.h>
+
+// Global numbering of structural genes. The same connection gets the same innovation number
+// in every genome, and splitting the same connection yields the same node id, so genes from
+// different genomes line up by number in crossover and compatibility. Safe to use from
+// several threads.
+class InnovationRegistry {
+public:
+    static InnovationRegistry &global();
+
+    // Innovation number of the connection from -> to
+    int connection(int from, int to);
+
+    // Same, or -1 if no genome has had that connection yet
+    [[nodiscard]] int find(int from, int to) const;
+
+    // Id of the node that splits the connection from -> to
+    int splitNode(int from, int to);
+
+    // Fresh node id, for a genome that already holds the split node of a connection
+    int newNode();
+
+    // Keeps future node ids at or above count
+    void reserveNodes(int count);
+
+    // Forgets the connections whose innovation number and the splits whose node id are not in
+    // the given live sets, so the maps track the genomes alive rather than every pair ever
+    // seen. Numbers are never handed out twice: a pruned connection that comes back gets a new
+    // one, so genomes kept outside the live sets must not meet genomes bred afterwards.
+    void prune(const std::unordered_set<int> &connections, const std::unordered_set<int> &nodes);
+
+    // Connections plus splits on record
+    [[nodiscard]] size_t size() const;
+
+    // Forgets every number handed out, so a new run in the same process numbers its genes the
+    // way a fresh process would. Genomes from before must not meet genomes from after.
+    void reset();
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::pair<int, int>, int, PairHash> connections_{}, splits_{};
+    int nextConnection_{0};
+    int nextNode_{0};
+};
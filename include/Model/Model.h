@@ -1,247 +1,160 @@
 #pragma once
 
-#include <unordered_map>
-#include <unordered_set>
+#include <vector>
+#include <memory>
+#include <cstdint>
 #include <Utils/RandomUtils.h>
 #include <Utils/MutationUtils.h>
+#include <Utils/CowVector.h>
+#include <Utils/CounterRng.h>
+#include <Model/Activation.h>
+#include <Model/Phenotype.h>
 #include <ostream>
 #include <istream>
 
 
-enum class ActivationType {
-    Identity,
-    Sigmoid,
-    ReLU,
-    Tanh
+// Ids below inputs + outputs are the fixed interface of every genome, in that order
+enum class NodeKind : uint8_t {
+    Input,
+    Output,
+    Hidden
 };
 
-struct Node {
-    Node(int id, bool hidden, bool input)
-            : id_(id),
-              bias_(input ? 0.0 : newValue()),
-              hidden_(hidden), input_(input),
-              activationType_(getRandomActivation()) {}
+// Node genes as parallel arrays sorted by node id. Copies share each array until it is
+// written, so clones and crossover children only pay for the arrays they change.
+struct NodeGenes {
+    CowVector<int> id{};
+    CowVector<NodeKind> kind{};
+    CowVector<ActivationType> activation{};
+    CowVector<double> bias{};
+    // Distinct ranks in a topological order of every connection, disabled ones included:
+    // each connection goes from a lower rank to a higher one
+    CowVector<int> rank{};
 
-    Node(int id, bool hidden, bool input, double bias, ActivationType activationType)
-            : id_(id),
-              bias_(bias),
-              hidden_(hidden), input_(input),
-              activationType_(activationType) {}
+    [[nodiscard]] size_t size() const { return id.size(); }
 
-    Node(int id, bool hidden, bool input, ActivationType activationType)
-            : id_(id),
-              bias_(input ? 0.0 : newValue()),
-              hidden_(hidden), input_(input),
-              activationType_(activationType) {}
+    // Index of the node with this id, or -1
+    [[nodiscard]] int find(int nodeId) const;
 
-    Node(const Node &other) = default;
+    void insert(int nodeId, NodeKind nodeKind, ActivationType nodeActivation, double nodeBias, int nodeRank);
 
-    void addIn(int i) { in_.insert(i); }
-
-    void removeIn(int i) { in_.erase(i); }
-
-    void addOut(int i) { out_.insert(i); }
-
-    void removeOut(int i) { out_.erase(i); }
-
-    void setValue(double value) { value_ = value; }
-
-    void setBias(double bias) { bias_ = bias; }
-
-    void setActivation(ActivationType activationType) { activationType_ = activationType; }
-
-    double getValue() const { return value_; }
-
-    bool isHidden() const { return hidden_; }
-
-    bool isInput() const { return input_; }
-
-    std::unique_ptr<Node> crossover(const Node *other) {
-        // maybe add id check
-        double bias = pickRandom(this->bias_, other->bias_);
-        auto activation = pickRandom(this->activationType_, other->activationType_);
-        return std::make_unique<Node>(this->getId(), false, false, bias, activation);
-    }
-
-    double activate(double input) {
-        switch (activationType_) {
-            case ActivationType::Identity:
-                return input;
-            case ActivationType::Sigmoid:
-                return 1.0 / (1.0 + std::exp(-input));
-            case ActivationType::ReLU:
-                return input > 0 ? input : 0;
-            case ActivationType::Tanh:
-                return std::tanh(input);
-            default:
-                return input;
-        }
-    }
-
-    static ActivationType getRandomActivation() {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        static std::uniform_int_distribution<> dist(0, 3);  // 4 types
-
-        return static_cast<ActivationType>(dist(gen));
-    }
-
-    [[nodiscard]] int getId() const { return id_; }
-
-    [[nodiscard]] double getBias() const { return bias_; }
-
-    [[nodiscard]] std::unordered_set<int> getIn() const { return in_; }
+    void erase(size_t index);
+};
 
-    [[nodiscard]] std::unordered_set<int> getOut() const { return out_; }
+// Connection genes as parallel arrays sorted by innovation number, shared the same way
+struct ConnectionGenes {
+    CowVector<int> innovation{};
+    CowVector<int> from{}, to{};
+    CowVector<double> weight{};
+    CowVector<uint8_t> enabled{};   // change through setEnabled() to keep active in sync
+    // Indices of the enabled connections in no particular order, and where each connection
+    // sits in it (-1 if disabled), so an enabled connection is drawn in O(1)
+    CowVector<int> active{}, activeAt{};
 
-    void save(std::ostream& out) const {
-        out.write(reinterpret_cast<const char*>(&id_), sizeof(id_));
-        out.write(reinterpret_cast<const char*>(&bias_), sizeof(bias_));
-        out.write(reinterpret_cast<const char*>(&hidden_), sizeof(hidden_));
-        out.write(reinterpret_cast<const char*>(&input_), sizeof(input_));
-        auto act = static_cast<int>(activationType_);
-        out.write(reinterpret_cast<const char*>(&act), sizeof(act));
+    [[nodiscard]] size_t size() const { return innovation.size(); }
 
-        size_t inSize = in_.size();
-        out.write(reinterpret_cast<const char*>(&inSize), sizeof(inSize));
-        for (int i : in_) out.write(reinterpret_cast<const char*>(&i), sizeof(i));
+    // Index of the connection with this innovation number, or -1
+    [[nodiscard]] int find(int connInnovation) const;
 
-        size_t outSize = out_.size();
-        out.write(reinterpret_cast<const char*>(&outSize), sizeof(outSize));
-        for (int i : out_) out.write(reinterpret_cast<const char*>(&i), sizeof(i));
-    }
+    void insert(int connInnovation, int fromId, int toId, double connWeight, bool connEnabled);
 
-    void load(std::istream& in) {
-        int act;
-        in.read(reinterpret_cast<char*>(&id_), sizeof(id_));
-        in.read(reinterpret_cast<char*>(&bias_), sizeof(bias_));
-        in.read(reinterpret_cast<char*>(&hidden_), sizeof(hidden_));
-        in.read(reinterpret_cast<char*>(&input_), sizeof(input_));
-        in.read(reinterpret_cast<char*>(&act), sizeof(act));
-        activationType_ = static_cast<ActivationType>(act);
-
-        size_t inSize;
-        in.read(reinterpret_cast<char*>(&inSize), sizeof(inSize));
-        in_.clear();
-        for (size_t i = 0; i < inSize; ++i) {
-            int v;
-            in.read(reinterpret_cast<char*>(&v), sizeof(v));
-            in_.insert(v);
-        }
-
-        size_t outSize;
-        in.read(reinterpret_cast<char*>(&outSize), sizeof(outSize));
-        out_.clear();
-        for (size_t i = 0; i < outSize; ++i) {
-            int v;
-            in.read(reinterpret_cast<char*>(&v), sizeof(v));
-            out_.insert(v);
-        }
-    }
+    void erase(size_t index);
 
-    std::unique_ptr<Node> clone() const {
-        auto cloned = std::make_unique<Node>(id_, hidden_, input_, bias_, activationType_);
-        cloned->in_ = in_;
-        cloned->out_ = out_;
-        cloned->value_ = value_;
-        return cloned;
-    }
+    void setEnabled(size_t index, bool connEnabled);
 
-private:
-    int id_;
-    double bias_, value_{0.0};
-    bool hidden_, input_;
-    ActivationType activationType_;
-    std::unordered_set<int> out_{}, in_{};
+    // Rebuilds active after the arrays were filled directly
+    void indexEnabled();
 };
 
-struct Connection {
-    Connection(double weight, int from, int to)
-            : weight_(weight), from_(from), to_(to), enabled_(true) {}
-
-    Connection(int from, int to)
-            : weight_(newValue()), from_(from), to_(to), enabled_(true) {}
-
-    Connection(const Connection &other) = default;
+class Model {
+public:
+    // Initial weights, and later mutations, are drawn from rng
+    Model(int inputs, int outputs, const CounterRng &rng = CounterRng(randomSeed()));
 
-    double getWeight() const { return weight_; }
+    // Use clone(), which shares the genes instead of copying them
+    Model(const Model &other) = delete;
 
-    void setWeight(double weight) { weight_ = weight; }
+    std::vector<double> feedForward(std::vector<double> &inputs);
 
-    int getFrom() const { return from_; }
+    // Allocation-free evaluation into caller-owned buffers; the counts must match the network.
+    void activate(const double *inputs, size_t inputCount, double *outputs, size_t outputCount);
 
-    int getTo() const { return to_; }
+    // rows row-major input rows in, rows output rows out; same values as feedForward() per row.
+    void activateBatch(const double *inputs, size_t rows, double *outputs);
 
-    bool isEnabled() const { return enabled_; }
+    // Index of the largest output per row, the action a ModelInputProvider would pick.
+    void decideBatch(const double *inputs, size_t rows, int *actions);
 
-    void setEnabled(bool enabled) { enabled_ = enabled; }
+    [[nodiscard]] int getInputCount() const { return inputs_; }
 
-    std::unique_ptr<Connection> crossover(const Connection *other) {
-        // maybe add id check
-        double weight = pickRandom(this->weight_, other->weight_);
-        auto conn = std::make_unique<Connection>(weight, this->getFrom(), this->getTo());
-        conn->setEnabled(pickRandom(this->enabled_, other->enabled_));
-        return conn;
-    }
+    [[nodiscard]] int getOutputCount() const { return outputs_; }
 
-    void save(std::ostream& out) const {
-        out.write(reinterpret_cast<const char*>(&weight_), sizeof(weight_));
-        out.write(reinterpret_cast<const char*>(&from_), sizeof(from_));
-        out.write(reinterpret_cast<const char*>(&to_), sizeof(to_));
-        out.write(reinterpret_cast<const char*>(&enabled_), sizeof(enabled_));
-    }
+    // Builds the flat phenotype if the genome changed since the last call.
+    void compile();
 
-    void load(std::istream& in) {
-        in.read(reinterpret_cast<char*>(&weight_), sizeof(weight_));
-        in.read(reinterpret_cast<char*>(&from_), sizeof(from_));
-        in.read(reinterpret_cast<char*>(&to_), sizeof(to_));
-        in.read(reinterpret_cast<char*>(&enabled_), sizeof(enabled_));
-    }
+    // Same, evaluating in the given precision from now on.
+    void compile(Precision precision);
 
-    std::unique_ptr<Connection> clone() const {
-        auto conn = std::make_unique<Connection>(weight_, from_, to_);
-        conn->setEnabled(enabled_);
-        return conn;
+    Phenotype &getPhenotype() {
+        compile();
+        return phenotype_;
     }
 
-
-private:
-    double weight_;
-    int from_, to_;
-    bool enabled_;
-};
-
-class Model {
-public:
-    Model(int inputs, int outputs);
-
-    std::vector<double> feedForward(std::vector<double> &inputs);
+    // Bumped whenever compile() rebuilds the phenotype
+    [[nodiscard]] unsigned getRevision() const { return revision_; }
 
     void setFitness(double fitness) { fitness_ = fitness; }
 
     void mutate();
 
-    std::unique_ptr<Model> crossover(Model *other);
+    // The child picks between matching genes, and later mutates, with rng
+    std::unique_ptr<Model> crossover(Model *other, const CounterRng &rng = CounterRng(randomSeed()));
 
     void save(std::ostream& out) const;
     void load(std::istream& in);
     double getCompatibilityDistance(Model *other);
-    std::unique_ptr<Model> clone() const;
+    // The clone mutates with rng
+    std::unique_ptr<Model> clone(const CounterRng &rng) const;
+
+    [[nodiscard]] const NodeGenes &getNodes() const { return nodes_; }
+
+    [[nodiscard]] const ConnectionGenes &getConnections() const { return connections_; }
 
 private:
-    int inputs_, outputs_, id_ = 0;
+    struct Empty {};
+
+    // No genes at all, for crossover() to fill in
+    Model(int inputs, int outputs, Empty);
+
+    int inputs_, outputs_;
     double fitness_{0.0};
-    std::unordered_map<int, std::unique_ptr<Node>> nodes_{};
-    std::vector<Node *> inputNodes_{}, outputNodes_{};
-    std::unordered_map<std::pair<int, int>, std::unique_ptr<Connection>, PairHash> connections_{};
+    // Nodes [0, inputs_) are the inputs and [inputs_, inputs_ + outputs_) the outputs,
+    // at the same indices since no other id is smaller and they are never removed; the
+    // hidden nodes are the rest
+    NodeGenes nodes_{};
+    ConnectionGenes connections_{};
     DoubleConfig mutationConfig_{};
-    std::mt19937 rng_{std::random_device{}()};
+    CounterRng rng_{};
+    Phenotype phenotype_{};
+    Precision precision_{Precision::Double};
+    bool compiled_{false};
+    unsigned revision_{0};
+
+    // Structure compile() depends on, the PlanCache key
+    [[nodiscard]] std::vector<int> structureKey() const;
 
-    void addConnection(Node *from, Node *to);
+    [[nodiscard]] std::shared_ptr<PhenotypePlan> buildPlan() const;
 
-    void addConnection(double weight, Node *from, Node *to);
+    void addConnection(int from, int to, double weight);
 
-    void removeConnection(Connection *connection);
+    void removeNode(size_t index);
+
+    // Reorders ranks so the node at index from precedes the one at index to, the way
+    // Pearce-Kelly does; false, with nothing changed, if from -> to would close a cycle
+    bool orderBefore(int from, int to);
+
+    // Ranks from scratch, dropping connections that close a cycle
+    void rebuildOrder();
 
     void addConnectionMutation();
 
@@ -250,6 +163,4 @@ private:
     void addNodeMutation();
 
     void removeNodeMutation();
-
-    static bool checkCycle(std::unordered_map<int, std::unique_ptr<Node> > *nodes, int from, int to);
 };
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <Model/Phenotype.h>
+
+// Straight-line C++ for a Double phenotype with 11 inputs and 3 outputs, compiled in
+// ActivationMode::Exact. The generated translation unit exports
+//     extern "C" void snake_forward(const double in[11], double out[3]);
+// with every weight and bias baked in as a hex-float constant.
+void exportNativeSource(const Phenotype &phenotype, std::ostream &out);
+
+using NativeForward = void (*)(const double *, double *);
+
+struct NativeModule {
+    void *handle = nullptr;
+    NativeForward forward = nullptr;
+};
+
+// Compiles the generated source with the system compiler ($SNAKE_CXX, $CXX or c++) into a
+// shared object and loads it. Builds are kept in $XDG_CACHE_HOME/snake-neat (or
+// ~/.cache/snake-neat), a 0700 directory only trusted while this user owns it and no one else
+// can write it, and reused for identical source. Without one each load builds in a private
+// temp directory. Returns an empty module when export, compilation or loading fails.
+NativeModule loadNativeModule(const Phenotype &phenotype, std::string *error = nullptr);
+
+void unloadNativeModule(NativeModule &module);
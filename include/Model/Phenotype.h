@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <Model/Activation.h>
+
+// Storage and arithmetic used to evaluate a phenotype. Weights live in [-1, 1] (see DoubleConfig),
+// so Int8 keeps one scale per network and stores q = round(w / scale); values stay float.
+enum class Precision {
+    Double,
+    Float,
+    Int8
+};
+
+// Last inputs and activations of one episode for Phenotype::activateIncremental().
+// Invalid once the phenotype is recompiled; reset() at every episode start.
+struct IncrementalState {
+    std::vector<double> values{};     // value slots after the previous step
+    std::vector<double> prefix{};     // running row sum after each edge
+    std::vector<uint8_t> changed{};   // per slot, this step
+    std::vector<uint8_t> dirty{};     // per computed node
+    bool primed = false;
+    long macs = 0;                    // multiply-adds performed
+    long fullMacs = 0;                // multiply-adds a full evaluation would have performed
+
+    void reset() { primed = false; }
+};
+
+// Size of the genome against what Model::compile() kept for evaluation
+struct CompileStats {
+    int genomeNodes = 0;
+    int genomeEdges = 0;
+    int nodes = 0;          // inputs plus nodes computed per evaluation
+    int edges = 0;          // multiply-adds per evaluation
+    int folded = 0;         // nodes whose value was fixed at compile time
+};
+
+// Structure of a phenotype: everything but the parameters. Genomes with the same topology
+// share one plan (see PlanCache), and each Phenotype only owns its weights and biases.
+struct PhenotypePlan {
+    int inputs = 0;
+    int constants = 0;
+    size_t topologyHash = 0;
+    std::vector<ActivationType> activation{};    // per computed node
+    std::vector<int> inStart{0};                 // CSR row offsets, one row per computed node
+    std::vector<int> inSource{};                 // index into the value slots
+    std::vector<int> outputIndex{};              // value slot per output
+    std::vector<int> outStart{}, outTarget{};    // CSR of computed nodes reading each slot
+
+    // Where each parameter comes from, as indices into the genome's node and connection
+    // arrays (equal structures index them identically); read by Model::compile()
+    std::vector<int> edgeGene{};                        // connection per edge
+    std::vector<int> rowNode{};                         // node per computed node
+    std::vector<int> constNode{};                       // node per constant
+    std::vector<int> constStart{0}, constSource{};      // folded edges into each constant
+    std::vector<int> seedStart{0}, seedSource{};        // folded edges leading each row
+    std::vector<int> constGene{}, seedGene{};           // connection per folded edge
+
+    [[nodiscard]] int computedBase() const { return inputs + constants; }
+
+    [[nodiscard]] size_t getBytes() const;
+
+    void hashTopology();
+
+    void indexConsumers();
+};
+
+// Flat, evaluation-only form of a Model: nodes in topological order (inputs first)
+// with incoming edges stored as CSR rows of contiguous source indices and weights.
+// Nodes that do not depend on any input are folded into constant slots, and constant
+// sources leading a row into that row's starting sum. Built once per genome by
+// Model::compile(), evaluated in a single linear pass.
+class Phenotype {
+public:
+    Phenotype();
+
+    explicit Phenotype(std::shared_ptr<const PhenotypePlan> plan);
+
+    // Reads getInputCount() inputs and writes getOutputCount() outputs. Works in per-thread
+    // scratch memory, so it never allocates once warm and may run on several threads at once.
+    void activate(const double *inputs, double *outputs) const;
+
+    void activate(const std::vector<double> &inputs, std::vector<double> &outputs) const;
+
+    // activate() over rows row-major input rows into rows output rows, bit for bit in either
+    // activation mode: the vector kernels of activateArray() run the same unfused arithmetic
+    // as applyActivation(). Double phenotypes run node-major over blocks of rows so every edge
+    // is one multiply-add across the block; large batches split their blocks over OpenMP threads.
+    void activateBatch(const double *inputs, size_t rows, double *outputs) const;
+
+    // Same outputs as activate(), bit for bit, but only recomputes the nodes downstream of
+    // inputs that changed since the previous call on this state, each from its first
+    // changed edge on, and stops propagating where a value comes out unchanged.
+    // Double precision only; other precisions fall back to a full evaluation.
+    void activateIncremental(IncrementalState &state, const std::vector<double> &inputs,
+                             std::vector<double> &outputs) const;
+
+    // Converts the parameters of a Double phenotype and releases the double buffers.
+    void setPrecision(Precision precision);
+
+    [[nodiscard]] Precision getPrecision() const { return precision_; }
+
+    [[nodiscard]] int getInputCount() const { return plan_->inputs; }
+
+    [[nodiscard]] int getOutputCount() const { return static_cast<int>(plan_->outputIndex.size()); }
+
+    // Value slots: inputs, then constants, then computed nodes
+    [[nodiscard]] int getNodeCount() const { return plan_->computedBase() + static_cast<int>(plan_->activation.size()); }
+
+    [[nodiscard]] int getConstantCount() const { return plan_->constants; }
+
+    [[nodiscard]] int getEdgeCount() const { return static_cast<int>(plan_->inSource.size()); }
+
+    // Parameters as doubles regardless of the storage precision
+    [[nodiscard]] double getWeight(int edge) const;
+
+    [[nodiscard]] double getBias(int node) const;
+
+    [[nodiscard]] double getSeed(int node) const;
+
+    [[nodiscard]] double getConstant(int constant) const;
+
+    [[nodiscard]] const CompileStats &getCompileStats() const { return stats_; }
+
+    // Activation mode the constant nodes were folded in
+    [[nodiscard]] ActivationMode getConstantMode() const { return constantMode_; }
+
+    // Hash of everything but the weights and biases; equal topologies evaluate with the same kernel.
+    [[nodiscard]] size_t getTopologyHash() const { return plan_->topologyHash; }
+
+    [[nodiscard]] bool hasSameTopology(const Phenotype &other) const;
+
+    [[nodiscard]] const std::shared_ptr<const PhenotypePlan> &getPlan() const { return plan_; }
+
+private:
+    friend class Model;
+    friend class BatchEvaluator;
+    friend void exportNativeSource(const Phenotype &phenotype, std::ostream &out);
+
+    template<typename Value, typename Weight>
+    void run(const double *inputs, const Value *constants, const Value *bias, const Value *seed,
+             const Weight *weight, double *outputs) const;
+
+    void runBlock(const double *inputs, size_t rows, double *outputs) const;
+
+    std::shared_ptr<const PhenotypePlan> plan_;
+    Precision precision_{Precision::Double};
+    ActivationMode constantMode_{ActivationMode::Exact};
+    CompileStats stats_{};
+
+    // Double
+    std::vector<double> values_{};                // one per slot, only the constant slots are used
+    std::vector<double> bias_{};                  // per computed node
+    std::vector<double> seed_{};                  // per computed node, sum of its folded constant edges
+    std::vector<double> inWeight_{};
+
+    // Float and Int8
+    std::vector<float> valuesF_{}, biasF_{}, seedF_{}, inWeightF_{};
+    std::vector<int8_t> inWeightQ_{};
+    float weightScale_{1.0f};
+};
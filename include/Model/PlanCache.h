@@ -0,0 +1,57 @@
+#pragma once
+
+#include <list>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <Model/Phenotype.h>
+
+struct PlanCacheStats {
+    long hits = 0;
+    long misses = 0;
+    long evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+};
+
+// Compiled phenotype plans keyed by the structure of the genome they came from, so clones,
+// elites and any other genomes with identical topology compile once and share the plan.
+// Least recently used plans are dropped past the byte budget; phenotypes holding an
+// evicted plan keep it alive. Safe to use from several threads.
+class PlanCache {
+public:
+    static constexpr size_t DefaultBudget = 64 << 20;
+
+    // The cache Model::compile() uses
+    static PlanCache &global();
+
+    // key fully describes the structure, hash is a hash of it
+    std::shared_ptr<const PhenotypePlan> find(size_t hash, const std::vector<int> &key);
+
+    void insert(size_t hash, std::vector<int> key, std::shared_ptr<const PhenotypePlan> plan);
+
+    // Evicts right away if the cache is over the new budget; 0 disables caching
+    void setBudget(size_t bytes);
+
+    void clear();
+
+    [[nodiscard]] PlanCacheStats getStats() const;
+
+private:
+    struct Entry {
+        size_t hash;
+        std::vector<int> key;
+        std::shared_ptr<const PhenotypePlan> plan;
+        size_t bytes;
+    };
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;   // most recently used first
+    std::unordered_multimap<size_t, std::list<Entry>::iterator> index_;
+    size_t budget_{DefaultBudget};
+    PlanCacheStats stats_{};
+
+    void evict();
+};
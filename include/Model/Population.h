@@ -7,58 +7,72 @@
 #include <queue>
 #include <iostream>
 #include "SnakeGame/ModelInputProvider.h"
+#include "SnakeGame/ModelPolicy.h"
 #include "SnakeGame/Game.h"
+#include "SnakeGame/VectorEnv.h"
+
+// How Individual::train evaluates its network
+struct EvaluationConfig {
+    Precision precision = Precision::Double;
+    bool incremental = false;
+    size_t decisionCacheEntries = 0;   // per genome, 0 disables the decision cache
+    bool lockstep = false;             // double precision plays through VectorEnv instead
+    int lockstepSlots = 256;           // games a VectorEnv plays at once, and models per VectorEnv
+};
 
 struct Individual {
 public:
-    Individual(int inputs, int outputs) :
-            model_(std::make_unique<Model>(inputs, outputs)),
+    Individual(int inputs, int outputs, const CounterRng &rng) :
             game_(800, 800, nullptr, nullptr),
-            fitness_(0) {
-        game_ = Game(800, 800,
-                     nullptr,
-                     std::make_unique<ModelInputProvider>(model_.get(), false));
-    };
+            model_(std::make_unique<Model>(inputs, outputs, rng)),
+            policy_(model_.get()),
+            fitness_(0) {}
 
     Individual(std::unique_ptr<Model> model) :
             game_(800, 800, nullptr, nullptr),
             model_(std::move(model)),
-            fitness_(0) {
-        game_ = Game(800, 800,
-                     nullptr,
-                     std::make_unique<ModelInputProvider>(model_.get(), false));
-    }
+            policy_(model_.get()),
+            fitness_(0) {}
 
     Individual(std::unique_ptr<Model> model, double fitness) :
             game_(800, 800, nullptr, nullptr),
             model_(std::move(model)),
-            fitness_(fitness) {
-        game_ = Game(800, 800,
-                     nullptr,
-                     std::make_unique<ModelInputProvider>(model_.get(), false));
-    }
+            policy_(model_.get()),
+            fitness_(fitness) {}
 
-    std::unique_ptr<Individual> clone() {
-        auto modelClone = model_->clone();
+    // The clone mutates from rng
+    std::unique_ptr<Individual> clone(const CounterRng &rng) {
+        auto modelClone = model_->clone(rng);
         auto clonedIndividual = std::make_unique<Individual>(std::move(modelClone),
                                                              fitness_);
         return std::move(clonedIndividual);
     }
 
+    // Episodes per evaluation, more stable fitness estimate (was 2)
+    static constexpr int Episodes = 5;
+
     [[nodiscard]] double getFitness() const { return fitness_; };
 
-    void train(double epsilon) {
-        fitness_ = 0;
-        int numTrain = 5;  // More stable fitness estimate (was 2)
+    // Fitness scored outside train(), e.g. by a VectorEnv
+    void setFitness(double fitness) {
+        fitness_ = fitness;
+        model_->setFitness(fitness_);
+    }
 
+    // Episode e plays the game drawn from episodes.split(e)
+    void train(double epsilon, const EvaluationConfig &config, const CounterRng &episodes) {
+        fitness_ = 0;
+        model_->compile(config.precision);
+        policy_.setIncremental(config.incremental);
+        policy_.setDecisionCache(config.decisionCacheEntries);
         double totalScore = 0.0;
-        for (int i = 0; i < numTrain; ++i) {
-            game_.start(epsilon);
+        for (int i = 0; i < Episodes; ++i) {
+            game_.setRng(episodes.split(i));
+            game_.start(policy_);
             totalScore += game_.getScore();
         }
 
-        fitness_ = totalScore / numTrain;
-        model_->setFitness(fitness_);
+        setFitness(totalScore / Episodes);
     }
 
     void play(Renderer *renderer) {
@@ -76,9 +90,12 @@ public:
 
     double checkCompatibility(Individual *other) { return model_->getCompatibilityDistance(other->getModel()); }
 
+    [[nodiscard]] const ModelPolicy &getPolicy() const { return policy_; }
+
 private:
-    Game game_;
+    Game game_;     // headless, played through policy_
     std::unique_ptr<Model> model_;
+    ModelPolicy policy_;
     double fitness_;
 };
 
@@ -89,8 +106,8 @@ struct Species {
     double maxFitness = -std::numeric_limits<double>::infinity();
     int stagnantGenerations = 0;
 
-    explicit Species(Individual *repr)
-            : representative(repr->clone()) {
+    Species(Individual *repr, const CounterRng &rng)
+            : representative(repr->clone(rng)) {
         members.push_back(repr);
         maxFitness = repr->getFitness();
     }
@@ -124,28 +141,47 @@ struct Species {
         return total;
     }
 
-    void chooseNewRepresentative() {
+    void chooseNewRepresentative(CounterRng &rng) {
         if (!members.empty()) {
             // Random or fitness-based
-            int idx = rand() % members.size(); // or use std::mt19937
-            representative = members[idx]->clone();
+            int idx = std::uniform_int_distribution<int>(0, static_cast<int>(members.size()) - 1)(rng);
+            representative = members[idx]->clone(rng.split(rng()));
         }
     }
 };
 
 class Population {
 public:
-    Population(int size);
+    // Everything random in the run derives from seed, so a seed replays the same run on any
+    // number of threads. Each generation prunes InnovationRegistry::global() to the genes its
+    // genomes hold, so one population evolves at a time per process.
+    Population(int size, uint64_t seed);
 
     void train(Renderer *renderer);
 
+    // Evaluates and breeds generations without rendering, saving or logging
+    void evolve(int generations);
+
     [[nodiscard]] Individual *getFittest();
 
     void crossover();
 
     void speciate();
 
+    void setEvaluation(const EvaluationConfig &evaluation) { evaluation_ = evaluation; }
+
+    [[nodiscard]] const std::vector<std::unique_ptr<Individual>> &getIndividuals() const { return individuals_; }
+
 private:
+    // Streams of one generation, split off the run stream
+    enum Stream : uint64_t {
+        Selection,      // parents, drawn in order
+        Offspring,      // individuals born into the generation, split by index
+        Evaluation,     // split by index, then by episode
+        Representative, // speciate(), drawn in order
+        Founder         // representatives of new species in speciate(), split by index
+    };
+
     int inputs_, outputs_, size_;
     int generation_{0};
     std::vector<std::unique_ptr<Individual>> individuals_;
@@ -153,4 +189,15 @@ private:
     int currMaxSpecies_{0};
     double compatibilityThreshold_ = 0.02;
     double maxSpecies_ = 10, stagnationThreshold_ = 100;
+    EvaluationConfig evaluation_{};
+    CounterRng rng_;
+
+    [[nodiscard]] CounterRng stream(int generation, Stream purpose) const {
+        return rng_.split(generation).split(purpose);
+    }
+
+    void evaluate();
+
+    // Drops the registry entries no individual or species representative holds
+    void pruneInnovations();
 };
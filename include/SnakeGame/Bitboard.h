@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Occupied cells of a board up to 64 x 64, one word per row with bit x for column x and one
+// per column with bit y for row y. Cells off the board read as free and are ignored when set
+// or cleared.
+class Bitboard {
+public:
+    static constexpr int MaxSize = 64;
+
+    [[nodiscard]] static bool inside(int x, int y) {
+        return static_cast<unsigned>(x) < MaxSize && static_cast<unsigned>(y) < MaxSize;
+    }
+
+    [[nodiscard]] bool test(int x, int y) const { return inside(x, y) && (rows_[y] >> x & 1); }
+
+    void set(int x, int y) {
+        if (!inside(x, y)) return;
+        rows_[y] |= uint64_t{1} << x;
+        columns_[x] |= uint64_t{1} << y;
+    }
+
+    void clear(int x, int y) {
+        if (!inside(x, y)) return;
+        rows_[y] &= ~(uint64_t{1} << x);
+        columns_[x] &= ~(uint64_t{1} << y);
+    }
+
+    void clear() {
+        rows_.fill(0);
+        columns_.fill(0);
+    }
+
+    [[nodiscard]] uint64_t getRow(int y) const { return rows_[y]; }
+
+    [[nodiscard]] uint64_t getColumn(int x) const { return columns_[x]; }
+
+    // Steps from (x, y), which must be inside, to the first set cell along the unit axis
+    // direction (dx, dy), or 0 if there is none
+    [[nodiscard]] int nearest(int x, int y, int dx, int dy) const {
+        if (dx != 0) return dx > 0 ? above(rows_[y], x) : below(rows_[y], x);
+        return dy > 0 ? above(columns_[x], y) : below(columns_[x], y);
+    }
+
+private:
+    std::array<uint64_t, MaxSize> rows_{};
+    std::array<uint64_t, MaxSize> columns_{};
+
+    // First set bit past bit i, as a distance from i; two shifts keep i = 63 defined
+    static int above(uint64_t line, int i) {
+        uint64_t ahead = line >> i >> 1;
+        return ahead ? __builtin_ctzll(ahead) + 1 : 0;
+    }
+
+    // Last set bit before bit i, as a distance from i
+    static int below(uint64_t line, int i) {
+        uint64_t behind = line & ((uint64_t{1} << i) - 1);
+        return behind ? i - (63 - __builtin_clzll(behind)) : 0;
+    }
+};
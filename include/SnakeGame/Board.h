@@ -0,0 +1,65 @@
+#pragma once
+
+#include <SnakeGame/Bitboard.h>
+
+// Board dimensions as compile-time constants, so bounds checks, ray limits and cell indices
+// fold into immediates
+template<int Cols, int Rows>
+struct FixedBoard {
+    static_assert(Cols > 0 && Rows > 0 && Cols <= Bitboard::MaxSize && Rows <= Bitboard::MaxSize,
+                  "Board must fit a Bitboard");
+
+    static constexpr int cols() { return Cols; }
+
+    static constexpr int rows() { return Rows; }
+
+    static constexpr bool onBoard(int x, int y) {
+        return static_cast<unsigned>(x) < static_cast<unsigned>(Cols) &&
+               static_cast<unsigned>(y) < static_cast<unsigned>(Rows);
+    }
+
+    static constexpr int cell(int x, int y) { return y * Cols + x; }
+};
+
+using Board20 = FixedBoard<20, 20>;
+using Board40 = FixedBoard<40, 40>;
+using Board64 = FixedBoard<64, 64>;
+
+// Any board up to Bitboard::MaxSize on a side, dimensions read at runtime
+struct DynamicBoard {
+    int cols_, rows_;
+
+    [[nodiscard]] int cols() const { return cols_; }
+
+    [[nodiscard]] int rows() const { return rows_; }
+
+    [[nodiscard]] bool onBoard(int x, int y) const {
+        return static_cast<unsigned>(x) < static_cast<unsigned>(cols_) &&
+               static_cast<unsigned>(y) < static_cast<unsigned>(rows_);
+    }
+
+    [[nodiscard]] int cell(int x, int y) const { return y * cols_ + x; }
+};
+
+// Specialized: withBoard() hands the square sizes below to FixedBoard code.
+// Dynamic: every size runs the DynamicBoard code, for comparison.
+enum class BoardDispatch {
+    Specialized,
+    Dynamic
+};
+
+void setBoardDispatch(BoardDispatch dispatch);
+
+BoardDispatch getBoardDispatch();
+
+// Calls f with Board20, Board40 or Board64 for those sizes and with a DynamicBoard otherwise.
+// Every instantiation of f must return the same type.
+template<typename F>
+decltype(auto) withBoard(int cols, int rows, F &&f) {
+    if (cols == rows && getBoardDispatch() == BoardDispatch::Specialized) {
+        if (cols == 20) return f(Board20{});
+        if (cols == 40) return f(Board40{});
+        if (cols == 64) return f(Board64{});
+    }
+    return f(DynamicBoard{cols, rows});
+}
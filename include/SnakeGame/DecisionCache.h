@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "InputProvider.h"
+
+// Direct-mapped memo from a sensor vector (Game::getInputs layout) to the decision taken
+// for it, for one genome. Keys are exact: the nine ray features are stored as k where the
+// value is 0 or exactly 1.0 / k, the food sin/cos as raw bits. Vectors that do not encode
+// that way bypass the cache, so cached play is bit-identical to uncached play.
+class DecisionCache {
+public:
+    // entries is rounded up to a power of two; 0 disables the cache. Keeps the
+    // contents when the capacity does not change.
+    void resize(size_t entries);
+
+    void clear();
+
+    void resetCounters();
+
+    [[nodiscard]] bool isEnabled() const { return !entries_.empty(); }
+
+    // On a miss the key is kept, and the following store() files the decision under it.
+    bool lookup(const std::vector<double> &inputs, Direction &decision);
+
+    void store(Direction decision);
+
+    [[nodiscard]] long getHits() const { return hits_; }
+
+    [[nodiscard]] long getMisses() const { return misses_; }
+
+    [[nodiscard]] long getBypassed() const { return bypassed_; }
+
+private:
+    static constexpr int Rays = 9;
+    static constexpr uint8_t Empty = 0xff;
+
+    struct Entry {
+        uint64_t angle[2];
+        uint8_t rays[Rays];
+        uint8_t decision = Empty;
+    };
+
+    std::vector<Entry> entries_{};
+    Entry pending_{};
+    size_t pendingIndex_{0};
+    bool pendingValid_{false};
+    long hits_{0}, misses_{0}, bypassed_{0};
+
+    bool encode(const std::vector<double> &inputs, Entry &key) const;
+};
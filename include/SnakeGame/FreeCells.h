@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Free cells of a board as cell indices (Board::cell) packed at the front of a dense array, with
+// each cell's slot in it, so a cell is taken or released in O(1) and a uniform free cell is one
+// draw. The order depends on the sequence of takes and releases since reset().
+class FreeCells {
+public:
+    // Every one of cells cells free, in index order
+    void reset(int cells) {
+        cells_.resize(cells);
+        slot_.resize(cells);
+        for (int i = 0; i < cells; ++i) {
+            cells_[i] = static_cast<uint16_t>(i);
+            slot_[i] = static_cast<uint16_t>(i);
+        }
+        size_ = cells;
+    }
+
+    // cell must be free; the last free cell fills its slot
+    void take(int cell) {
+        int slot = slot_[cell];
+        int last = cells_[--size_];
+        cells_[slot] = static_cast<uint16_t>(last);
+        slot_[last] = static_cast<uint16_t>(slot);
+        cells_[size_] = static_cast<uint16_t>(cell);
+        slot_[cell] = static_cast<uint16_t>(size_);
+    }
+
+    // cell must be taken; it joins the end of the free cells
+    void release(int cell) {
+        int slot = slot_[cell];
+        int first = cells_[size_];
+        cells_[slot] = static_cast<uint16_t>(first);
+        slot_[first] = static_cast<uint16_t>(slot);
+        cells_[size_] = static_cast<uint16_t>(cell);
+        slot_[cell] = static_cast<uint16_t>(size_);
+        size_++;
+    }
+
+    [[nodiscard]] int size() const { return size_; }
+
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    // The i-th free cell, i < size()
+    [[nodiscard]] int operator[](int i) const { return cells_[i]; }
+
+private:
+    std::vector<uint16_t> cells_;   // free cells, then taken ones
+    std::vector<uint16_t> slot_;    // position of each cell in cells_
+    int size_ = 0;
+};
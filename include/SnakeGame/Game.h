@@ -1,28 +1,107 @@
 #pragma once
+#include <cstdint>
 #include <deque>
+#include <memory>
 #include <utility>
+#include <vector>
 #include <SnakeGame/Snake.h>
+#include <Utils/RandomUtils.h>
 #include "InputProvider.h"
 #include "Renderer.h"
 
+// How an episode stands after reset() or step()
+struct StepInfo {
+    int steps = 0;          // steps taken so far
+    int length = 0;         // snake length
+    bool ate = false;       // the head reached the food on this step
+    bool looping = false;   // ended by the loop detector, score halved
+    bool trapped = false;   // ended looping while starving, not penalized
+    bool collided = false;  // ended on a wall or the body
+    bool won = false;       // ended with the snake filling every cell the food could take
+    double score = 0.0;     // episode score, set once done
+};
+
+struct StepResult {
+    std::vector<double> observation;    // getInputs() for the next action, stale once done
+    bool done = false;
+    StepInfo info;
+};
+
 class Game {
 public:
     Game(int gridWidth, int gridHeight, Renderer* renderer, std::unique_ptr<InputProvider> inputProvider);
 
+    // Plays an episode from reset() to the end, asking the input provider for every action
     void start(double epsilon);
+    // Plays the same episode headless with policy.decide(observation) choosing every action and
+    // policy.reset() called first, e.g. a ModelPolicy. The call is static, so decide() inlines
+    // into the step loop where start(epsilon) makes a virtual call per step.
+    template<typename Policy>
+    void start(Policy& policy) {
+        withBoard(cols_, rows_, [&](auto board) {
+            policy.reset();
+            beginEpisode();
+            while (!result_.done) step(board, policy.decide(result_.observation));
+        });
+    }
     void render();
     double getScore(){ return score_;};
     void getInputs(std::vector<double>& inputs);
-    void reset();
+    // Starts an episode drawn from the stream set by setRng()
+    const StepResult& reset();
+    // Starts an episode drawn from the stream keyed by seed, e.g. CounterRng::split(e).getKey()
+    const StepResult& reset(uint64_t seed);
+    // Applies one action and advances to the next decision. The result stays valid until the
+    // next reset() or step(); no step allocates once the first episode has run.
+    const StepResult& step(Direction action);
+    // What the last reset() or step() reported
+    const StepResult& getState() const { return result_; }
+    // Stream the next reset() and the food of that episode are drawn from
+    void setRng(const CounterRng& rng) { rng_ = rng; }
+
+    static constexpr int MaxSteps = 10000;
+
+    // Board cells along a side of the given pixel size
+    static int toCells(int pixels) { return pixels / CellSize_; }
+
+    // Free cell for the food, one uniform draw from rng; free must not be empty
+    static std::pair<int, int> drawFood(const FreeCells& free, int cols, CounterRng& rng);
+
+    // Score of an episode that ended after steps steps with a snake of length cells and growth
+    // more eaten but not grown yet, e.g. the food that won the board
+    static double scoreEpisode(int length, int growth, int steps, bool looping);
 private:
     Snake snake_;
     std::pair<int, int> food_;
     std::unique_ptr<InputProvider> inputProvider_;
     int gridW_, gridH_, steps_;
+    int cols_, rows_;   // board cells, gridW_ / CellSize_ by gridH_ / CellSize_
     double score_;
     Renderer* renderer_;
     static const int CellSize_ = 20;
-    std::mt19937 rng_{std::random_device{}()};
+    CounterRng rng_{randomSeed()};
+    std::vector<int> visits_;   // head visits per cell over the loop detector's window
+
+    // Episode state between steps: the loop detector's window, its cells visited more than
+    // three times, steps since the last food, and what the last reset() or step() reported
+    std::deque<std::pair<int, int>> headHistory_;
+    int overVisited_{0};
+    int hunger_{0};
+    StepResult result_;
 
+    // Episode loop and step() with the board as a type, see withBoard(). step() is instantiated
+    // in Game.cpp for the board types.
+    template<typename Board>
+    void play(Board board);
+    template<typename Board>
+    const StepResult& step(Board board, Direction action);
+    // reset() without the input provider
+    void beginEpisode();
+    // Scores the episode and marks it done
+    void endEpisode();
+    // Head history, hunger and food for the step about to be decided, then its sensors
+    template<typename Board>
+    void advance(Board board);
     void generateFood();
+    void placeSnake(int minX, int maxX, int minY, int maxY);
 };
\ No newline at end of file
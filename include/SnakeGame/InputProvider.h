@@ -13,4 +13,7 @@ public:
     virtual ~InputProvider() = default;
 
     virtual Direction getInput(std::vector<double>& inputs) = 0;
+
+    // Called by Game at the start of every episode.
+    virtual void reset() {}
 };
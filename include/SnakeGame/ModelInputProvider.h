@@ -1,16 +1,30 @@
 #pragma once
 
 #include "InputProvider.h"
-#include "../Model/Model.h"
+#include "ModelPolicy.h"
 #include <SDL.h>
 
+// ModelPolicy behind the InputProvider interface, polling SDL events first when rendering
 class ModelInputProvider : public InputProvider {
 public:
-    explicit ModelInputProvider(Model* model, bool render) : model_(model), render_(render){}
+    explicit ModelInputProvider(Model* model, bool render)
+            : policy_(model), render_(render) {}
 
     Direction getInput(std::vector<double>& inputs) override;
 
+    void reset() override { policy_.reset(); }
+
+    // Evaluate through Phenotype::activateIncremental
+    void setIncremental(bool incremental) { policy_.setIncremental(incremental); }
+
+    // See ModelPolicy::setDecisionCache
+    void setDecisionCache(size_t entries) { policy_.setDecisionCache(entries); }
+
+    [[nodiscard]] const IncrementalState& getIncrementalState() const { return policy_.getIncrementalState(); }
+
+    [[nodiscard]] const DecisionCache& getDecisionCache() const { return policy_.getDecisionCache(); }
+
 private:
-    Model* model_;
+    ModelPolicy policy_;
     bool render_;
 };
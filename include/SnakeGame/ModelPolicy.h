@@ -0,0 +1,64 @@
+#pragma once
+
+#include "InputProvider.h"
+#include "DecisionCache.h"
+#include "../Model/Model.h"
+#include <algorithm>
+
+// The network's decision for a sensor vector, without SDL or a virtual call. Game::start(policy)
+// calls decide() statically so it inlines into the step loop; ModelInputProvider wraps one for
+// the InputProvider path.
+class ModelPolicy {
+public:
+    explicit ModelPolicy(Model *model) : model_(model), outputs_(model->getOutputCount()) {}
+
+    Direction decide(std::vector<double> &inputs) {
+        // Recompiles first if needed, e.g. after an activation mode switch, which bumps the
+        // revision. Cached decisions and incremental values only hold for the phenotype they
+        // came from.
+        Phenotype &phenotype = model_->getPhenotype();
+        if (revision_ != model_->getRevision()) {
+            cache_.clear();
+            state_.reset();
+            revision_ = model_->getRevision();
+        }
+        Direction decision;
+        if (cache_.isEnabled() && cache_.lookup(inputs, decision))
+            return decision;
+
+        if (incremental_)
+            phenotype.activateIncremental(state_, inputs, outputs_);
+        else
+            model_->activate(inputs.data(), inputs.size(), outputs_.data(), outputs_.size());
+        auto maxIt = std::max_element(outputs_.begin(), outputs_.end());
+        decision = static_cast<Direction>(std::distance(outputs_.begin(), maxIt));
+
+        cache_.store(decision);
+        return decision;
+    }
+
+    // Called by Game at the start of every episode
+    void reset() { state_.reset(); }
+
+    // Evaluate through Phenotype::activateIncremental
+    void setIncremental(bool incremental) { incremental_ = incremental; }
+
+    // Memoize decisions per exact sensor vector; 0 entries turns the cache off.
+    // Restarts the hit counters, keeps the entries when the capacity is unchanged.
+    void setDecisionCache(size_t entries) {
+        cache_.resize(entries);
+        cache_.resetCounters();
+    }
+
+    [[nodiscard]] const IncrementalState &getIncrementalState() const { return state_; }
+
+    [[nodiscard]] const DecisionCache &getDecisionCache() const { return cache_; }
+
+private:
+    Model *model_;
+    bool incremental_{false};
+    IncrementalState state_;
+    DecisionCache cache_;
+    unsigned revision_{0};
+    std::vector<double> outputs_;   // sized once, decide() never allocates
+};
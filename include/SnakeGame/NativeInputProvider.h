@@ -0,0 +1,30 @@
+#pragma once
+
+#include "InputProvider.h"
+#include "ModelInputProvider.h"
+#include "../Model/NativeCodegen.h"
+
+// Drop-in replacement for ModelInputProvider that runs the network as compiled native
+// code. Falls back to the interpreted phenotype when the module cannot be built.
+class NativeInputProvider : public InputProvider {
+public:
+    NativeInputProvider(Model *model, bool render);
+
+    ~NativeInputProvider() override;
+
+    NativeInputProvider(const NativeInputProvider &) = delete;
+
+    NativeInputProvider &operator=(const NativeInputProvider &) = delete;
+
+    Direction getInput(std::vector<double> &inputs) override;
+
+    [[nodiscard]] bool isNative() const { return module_.forward != nullptr; }
+
+    [[nodiscard]] const std::string &getError() const { return error_; }
+
+private:
+    ModelInputProvider fallback_;
+    NativeModule module_{};
+    std::string error_;
+    bool render_;
+};
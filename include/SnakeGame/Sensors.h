@@ -0,0 +1,20 @@
+#pragma once
+
+#include <utility>
+#include <SnakeGame/Bitboard.h>
+#include <SnakeGame/Board.h>
+
+// Values senseState() writes, the network's input count
+constexpr int SensorCount = 11;
+
+// Network inputs for a snake on board: wall, body and food along the front, left and right
+// rays, then sin and cos of the angle from the heading to the food. occupied holds the body;
+// the head may be off the board on the last step of a game. Instantiated in Sensors.cpp for
+// the boards withBoard() dispatches to.
+template<typename Board>
+void senseState(Board board, const Bitboard &occupied, std::pair<int, int> head, std::pair<int, int> dir,
+                std::pair<int, int> food, double *inputs);
+
+// Same for a cols x rows board, dispatched through withBoard() on every call
+void senseState(const Bitboard &occupied, int cols, int rows, std::pair<int, int> head, std::pair<int, int> dir,
+                std::pair<int, int> food, double *inputs);
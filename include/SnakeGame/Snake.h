@@ -1,25 +1,121 @@
 #pragma once
-#include <deque>
+#include <cstddef>
+#include <cstdint>
 #include <utility>
-#include <unordered_set>
-#include "Utils/RandomUtils.h"
+#include <vector>
+#include <SnakeGame/Bitboard.h>
+#include <SnakeGame/Board.h>
+#include <SnakeGame/FreeCells.h>
 
 class Snake {
 public:
-    Snake(int startX, int startY);
+    // Boards up to Bitboard::MaxSize on a side
+    Snake(int cols, int rows);
 
-    void move();
+    // Four segments with the head at start; direction: 0 right, 1 left, 2 up, 3 down
+    void reset(int startX, int startY, int direction);
+
+    // Unit step of a reset() direction
+    static std::pair<int, int> getHeading(int direction);
+
+    void move() { move(DynamicBoard{cols_, rows_}); }
+    // Same with the snake's own board as a type, see withBoard()
+    template<typename Board>
+    void move(Board board);
     void grow();
     void turnRight();
     void turnLeft();
-    bool checkCollision(int gridWidth, int gridHeight, bool* bodyCollide) const;
+    bool checkCollision(int gridWidth, int gridHeight, bool* bodyCollide) const {
+        return checkCollision(DynamicBoard{gridWidth, gridHeight}, bodyCollide);
+    }
+    template<typename Board>
+    bool checkCollision(Board board, bool* bodyCollided) const;
     std::pair<int, int> getDir();
 
-    [[nodiscard]] const std::deque<std::pair<int, int> >& getBody() const;
-    [[nodiscard]] const std::pair<int, int>& getHead() const;
+    [[nodiscard]] std::pair<int, int> getHead() const { return getSegment(0); }
+
+    [[nodiscard]] std::size_t getLength() const { return length_; }
+
+    // Segments eaten but not grown yet; the next moves add them
+    [[nodiscard]] int getGrowth() const { return growAmount_; }
+
+    // Segment index from the head, 0 being the head itself
+    [[nodiscard]] std::pair<int, int> getSegment(std::size_t index) const {
+        const Cell &cell = cells_[(head_ - index) & mask_];
+        return {cell.x, cell.y};
+    }
+
+    // Cells under any segment on the board; the start may leave a few segments off it
+    [[nodiscard]] const Bitboard& getOccupancy() const { return occupied_; }
+
+    [[nodiscard]] bool isOccupied(int x, int y) const { return occupied_.test(x, y); }
+
+    // The cells getOccupancy() leaves free, kept in step with it
+    [[nodiscard]] const FreeCells& getFreeCells() const { return free_; }
 
 private:
-    std::deque<std::pair<int, int> > body_;
-    std::unordered_multiset<std::pair<int, int>, PairHash> positions_;
-    int dirX_, dirY_, growAmount_{0};;
-};
\ No newline at end of file
+    // Room for segments a few cells off the board
+    struct Cell {
+        int8_t x, y;
+    };
+
+    // Ring buffer of segments, the head at head_ and the tail length_ - 1 slots behind it
+    std::vector<Cell> cells_;
+    std::size_t mask_, head_{0}, length_{0};
+    int cols_, rows_;
+    Bitboard occupied_{};
+    FreeCells free_;
+    bool bodyCollided_{false};   // the head moved onto a segment
+    int dirX_{0}, dirY_{0}, growAmount_{0};
+
+    template<typename Board>
+    void push(Board board, int x, int y) {
+        head_ = (head_ + 1) & mask_;
+        cells_[head_] = {static_cast<int8_t>(x), static_cast<int8_t>(y)};
+        if (board.onBoard(x, y) && !occupied_.test(x, y)) {
+            occupied_.set(x, y);
+            free_.take(board.cell(x, y));
+        }
+        length_++;
+    }
+};
+
+template<typename Board>
+void Snake::move(Board board) {
+    auto head = getHead();
+    head.first += dirX_;
+    head.second += dirY_;
+
+    // The tail leaves before the head arrives, so following it closely is no collision
+    if (growAmount_ > 0) {
+        growAmount_--;
+    } else {
+        auto tail = getSegment(length_ - 1);
+        if (board.onBoard(tail.first, tail.second) && occupied_.test(tail.first, tail.second)) {
+            occupied_.clear(tail.first, tail.second);
+            free_.release(board.cell(tail.first, tail.second));
+        }
+        length_--;
+    }
+
+    if (occupied_.test(head.first, head.second))
+        bodyCollided_ = true;
+    push(board, head.first, head.second);
+}
+
+template<typename Board>
+bool Snake::checkCollision(Board board, bool* bodyCollided) const {
+    auto head = getHead();
+
+    // Wall collision
+    if (!board.onBoard(head.first, head.second))
+        return true;
+
+    // Self-collision
+    if (bodyCollided_) {
+        *bodyCollided = true;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <SnakeGame/Bitboard.h>
+#include <SnakeGame/Board.h>
+#include <SnakeGame/FreeCells.h>
+#include <Model/BatchEvaluator.h>
+#include <Utils/CounterRng.h>
+
+class Model;
+
+struct VectorEnvStats {
+    long ticks = 0;     // lockstep steps of the whole batch
+    long steps = 0;     // game steps summed over slots
+    long episodes = 0;
+    long refills = 0;   // evaluator rebuilds after slots were refilled or retired
+};
+
+// Plays many snake games in lockstep with the state of every game in flat per-slot arrays.
+// Each tick senses every live slot, makes one batched network call through BatchEvaluator,
+// then turns, checks and moves them all. Episodes wait in a queue; once a quarter of the
+// batch has finished, idle slots take the next ones and the evaluator rows are rebuilt.
+// Episodes follow the rules of Game::start, a won board included, and, drawn from the same
+// stream, score exactly what it scores in either activation mode.
+class VectorEnv {
+public:
+    // Boards up to Bitboard::MaxSize on a side, at most slots games at a time. Each slot
+    // holds a few KB of board state, so the default keeps a batch within L2.
+    VectorEnv(int cols, int rows, int slots = 256);
+
+    // Mean score of episodes games per model, game e of model i drawn from streams[i].split(e)
+    // the way Individual::train plays them. Models are compiled in double precision.
+    void run(const std::vector<Model *> &models, const std::vector<CounterRng> &streams, int episodes,
+             std::vector<double> &scores);
+
+    [[nodiscard]] const VectorEnvStats &getStats() const { return stats_; }
+
+private:
+    struct Cell {
+        int8_t x, y;
+    };
+
+    int cols_, rows_;
+    std::size_t slots_;
+    std::size_t capacity_;   // ring buffer slots per body, a power of two
+    std::size_t historyCapacity_;   // head history entries per slot, the loop window's bound
+    BatchEvaluator evaluator_{};
+    VectorEnvStats stats_{};
+
+    // Per slot; item_ is the queued episode the slot plays, -1 when idle
+    std::vector<long> item_;
+    std::vector<CounterRng> rng_;
+    std::vector<int> headX_, headY_, dirX_, dirY_, foodX_, foodY_;
+    std::vector<int> length_, grow_, steps_, hunger_, overVisited_;
+    std::vector<uint8_t> bodyCollided_;
+
+    // Per slot, concatenated: bodies as ring buffers with the head at bodyHead_, occupancy and
+    // its free cells, head visits per cell, and the loop detector's head history as a ring of
+    // cell indices (-1 off the board)
+    std::vector<Cell> cells_;
+    std::vector<std::size_t> bodyHead_;
+    std::vector<Bitboard> occupied_;
+    std::vector<FreeCells> free_;
+    std::vector<uint16_t> visits_;
+    std::vector<int16_t> history_;
+    std::vector<std::size_t> historyStart_, historySize_;
+
+    // Evaluator rows: the slot behind each row and whether it still plays
+    std::vector<std::size_t> lanes_;
+    std::vector<uint8_t> laneLive_;
+    std::vector<Phenotype *> lanePhenotypes_;
+    std::vector<double> inputs_, outputs_;
+
+    // The tick loop with the board as a type, see withBoard(); score gets one entry per episode
+    template<typename Board>
+    void play(Board board, const std::vector<Phenotype *> &phenotypes, const std::vector<CounterRng> &streams,
+              int episodes, std::vector<double> &score);
+
+    void startEpisode(std::size_t slot, const CounterRng &stream);
+
+    // Records the episode of the slot behind lane and retires the lane
+    void finishEpisode(std::size_t lane, double episodeScore, std::vector<double> &score);
+
+    void pushHistory(std::size_t slot, int cell);
+
+    int popHistory(std::size_t slot);
+
+    template<typename Board>
+    void pushSegment(Board board, std::size_t slot, int x, int y) {
+        std::size_t &head = bodyHead_[slot];
+        head = (head + 1) & (capacity_ - 1);
+        cells_[slot * capacity_ + head] = {static_cast<int8_t>(x), static_cast<int8_t>(y)};
+        if (board.onBoard(x, y) && !occupied_[slot].test(x, y)) {
+            occupied_[slot].set(x, y);
+            free_[slot].take(board.cell(x, y));
+        }
+        length_[slot]++;
+    }
+
+    // As Snake::move: the tail leaves before the head arrives
+    template<typename Board>
+    void move(Board board, std::size_t slot) {
+        int x = headX_[slot] + dirX_[slot];
+        int y = headY_[slot] + dirY_[slot];
+
+        if (grow_[slot] > 0) {
+            grow_[slot]--;
+        } else {
+            const Cell &tail = cells_[slot * capacity_ + ((bodyHead_[slot] - (length_[slot] - 1)) & (capacity_ - 1))];
+            if (board.onBoard(tail.x, tail.y) && occupied_[slot].test(tail.x, tail.y)) {
+                occupied_[slot].clear(tail.x, tail.y);
+                free_[slot].release(board.cell(tail.x, tail.y));
+            }
+            length_[slot]--;
+        }
+
+        if (occupied_[slot].test(x, y))
+            bodyCollided_[slot] = 1;
+        pushSegment(board, slot, x, y);
+        headX_[slot] = x;
+        headY_[slot] = y;
+    }
+};
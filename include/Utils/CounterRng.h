@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+// Counter-based generator: number n of a stream is a pure function of the stream key and n,
+// so blocks of a stream can be drawn in parallel, skipped or replayed without carrying any
+// state around. Also usable as a standard random bit generator over its running counter.
+// Streams split into independent substreams by id, e.g. run -> generation -> individual ->
+// episode, so what a part draws depends only on its ids and never on which thread ran first.
+class CounterRng {
+public:
+    using result_type = uint32_t;
+
+    CounterRng() = default;
+
+    explicit CounterRng(uint64_t key)
+            : key0_(static_cast<uint32_t>(key)), key1_(static_cast<uint32_t>(key >> 32)) {}
+
+    // 32-bit integer hash with low bias (lowbias32); SIMD kernels repeat it lane by lane
+    static constexpr uint32_t mix(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // 64-bit mixer of splitmix64, for deriving keys
+    static constexpr uint64_t mix64(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // Substream id of this one, independent of it and of every other id
+    [[nodiscard]] CounterRng split(uint64_t id) const { return CounterRng(mix64(getKey() ^ mix64(id))); }
+
+    [[nodiscard]] uint32_t bits(uint32_t counter) const { return mix(mix(counter ^ key0_) + key1_); }
+
+    // Uniform in [0, 1) from the 32 bits at counter
+    [[nodiscard]] double uniform(uint32_t counter) const {
+        return static_cast<int32_t>(bits(counter)) * 0x1p-32 + 0.5;
+    }
+
+    // Reserves the next count numbers of the running stream, returning the first counter
+    uint32_t take(uint32_t count) {
+        uint32_t first = counter_;
+        counter_ += count;
+        return first;
+    }
+
+    [[nodiscard]] uint64_t getKey() const { return static_cast<uint64_t>(key1_) << 32 | key0_; }
+
+    [[nodiscard]] uint32_t getKey0() const { return key0_; }
+
+    [[nodiscard]] uint32_t getKey1() const { return key1_; }
+
+    static constexpr result_type min() { return 0; }
+
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() { return bits(counter_++); }
+
+private:
+    uint32_t key0_{0}, key1_{0};
+    uint32_t counter_{0};
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+// A vector whose copies share one buffer until written. Copying is a reference count bump;
+// write() clones the elements first if anything else still shares them. Reads never copy.
+template<typename T>
+class CowVector {
+public:
+    CowVector() : data_(shared()) {}
+
+    explicit CowVector(std::vector<T> values) : data_(std::make_shared<std::vector<T>>(std::move(values))) {}
+
+    [[nodiscard]] const T &operator[](size_t index) const { return (*data_)[index]; }
+
+    [[nodiscard]] size_t size() const { return data_->size(); }
+
+    [[nodiscard]] bool empty() const { return data_->empty(); }
+
+    [[nodiscard]] const T *data() const { return data_->data(); }
+
+    [[nodiscard]] const T &back() const { return data_->back(); }
+
+    [[nodiscard]] typename std::vector<T>::const_iterator begin() const { return data_->begin(); }
+
+    [[nodiscard]] typename std::vector<T>::const_iterator end() const { return data_->end(); }
+
+    // The elements, for writing; invalidates earlier references into this vector
+    std::vector<T> &write() {
+        if (data_.use_count() > 1)
+            data_ = std::make_shared<std::vector<T>>(*data_);
+        return *data_;
+    }
+
+    [[nodiscard]] bool shares(const CowVector &other) const { return data_ == other.data_; }
+
+private:
+    std::shared_ptr<std::vector<T>> data_;
+
+    // Every empty vector starts out on this one, so default construction does not allocate
+    static const std::shared_ptr<std::vector<T>> &shared() {
+        static const auto instance = std::make_shared<std::vector<T>>();
+        return instance;
+    }
+};
@@ -1,9 +1,8 @@
 #pragma once
 
-#include <random>
-#include <unordered_map>
-#include <random>
-#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <Utils/CounterRng.h>
 
 struct DoubleConfig {
     double init_mean = 0.0;
@@ -15,22 +14,19 @@ struct DoubleConfig {
     double replace_rate = 0.1;       // More exploration (was 0.01)
 };
 
-static DoubleConfig mutationConfig{};
-static std::mt19937 rng_{std::random_device{}()};
-
-inline double clamp(double x) {
-    return std::min(mutationConfig.max, std::max(mutationConfig.min, x));
+// Fresh value, uniform in [min, max], from the next number of rng
+inline double newValue(const DoubleConfig &config, CounterRng &rng) {
+//    std::normal_distribution<double> dist(config.init_mean, config.init_stdev);
+    return config.min + rng.uniform(rng.take(1)) * (config.max - config.min);
 }
 
-inline double newValue() {
-//    static std::normal_distribution<double> dist(mutationConfig.init_mean, mutationConfig.init_stdev);
-    static std::uniform_real_distribution<double> dist(mutationConfig.min, mutationConfig.max);
-    return clamp(dist(rng_));
-}
+// Mutates n values in place by the rules above: each one, with probability mutation_rate, is
+// either replaced by a fresh value (probability replace_rate) or moved by a uniform step of
+// at most mutation_power, then clamped to [min, max]. Entries whose mask byte is 0 stay as
+// they are; mask may be null. Value i reads counters first + 3i to first + 3i + 2 of rng,
+// so every kernel produces the same bits.
+void mutateArray(const DoubleConfig &config, const CounterRng &rng, uint32_t first,
+                 double *values, const uint8_t *mask, size_t n);
 
-inline double mutationDelta(double value) {
-//    std::normal_distribution<double> dist(0.0, mutationConfig.mutation_power);
-    static std::uniform_real_distribution<double> dist(-mutationConfig.mutation_power, mutationConfig.mutation_power);
-    double delta = dist(rng_);
-    return clamp(value + delta);
-}
\ No newline at end of file
+// Name of the mutation kernel picked for this CPU at startup: "avx2" or "scalar".
+const char *getMutationKernelName();
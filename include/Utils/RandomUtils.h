@@ -1,24 +1,9 @@
 #pragma once
 
 #include <random>
-#include <unordered_map>
-#include <iterator>
-#include <stdexcept>
-
-// Thread-safe random pair selection from a map
-template <typename MapType>
-const typename MapType::value_type& getRandomPair(const MapType& map) {
-    if (map.empty()) {
-        throw std::runtime_error("Map is empty!");
-    }
-
-    thread_local static std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<size_t> dist(0, map.size() - 1);
-
-    auto it = map.begin();
-    std::advance(it, dist(rng));
-    return *it;
-}
+#include <atomic>
+#include <cstdint>
+#include <Utils/CounterRng.h>
 
 // Hash function for pair<int, int>
 struct PairHash {
@@ -27,18 +12,17 @@ struct PairHash {
     }
 };
 
-// Thread-safe random choice between two values
-template <typename T>
-T pickRandom(const T& a, const T& b) {
-    thread_local static std::mt19937 gen(std::random_device{}());
-    std::bernoulli_distribution dist(0.5);  // Recreate each call (cheap)
-
-    return dist(gen) ? a : b;
+// Random choice between two values, one bit of rng
+template <typename T, typename Rng>
+T pickRandom(const T& a, const T& b, Rng& rng) {
+    return (rng() & 1) ? a : b;
 }
 
-// Thread-safe random double in [0, 1)
-inline double randomDouble01() {
-    thread_local static std::mt19937 rng(std::random_device{}());
-    thread_local static std::uniform_real_distribution<double> dist(0.0, 1.0);
-    return dist(rng);
+// Key for a stream nobody keyed explicitly: distinct on every call and safe from any thread,
+// but never reproducible, since it mixes in std::random_device. Population keys its streams
+// itself, from the run seed.
+inline uint64_t randomSeed() {
+    static const uint64_t base = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+    static std::atomic<uint64_t> next{0};
+    return CounterRng::mix64(base + next.fetch_add(1, std::memory_order_relaxed));
 }
@@ -0,0 +1,177 @@
+#include "Model/Activation.h"
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SNAKE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    std::atomic<ActivationMode> activationMode{ActivationMode::Exact};
+
+    void reluScalar(double *values, size_t n, size_t i) {
+        for (; i < n; ++i) values[i] = values[i] > 0 ? values[i] : 0;
+    }
+
+    void exactScalar(ActivationType type, double *values, size_t n) {
+        for (size_t i = 0; i < n; ++i) values[i] = applyActivation(type, values[i]);
+    }
+
+    void fastScalar(ActivationType type, double *values, size_t n, size_t i) {
+        if (type == ActivationType::Tanh) {
+            for (; i < n; ++i) values[i] = fastmath::tanh(values[i]);
+        } else {
+            for (; i < n; ++i) values[i] = fastmath::sigmoid(values[i]);
+        }
+    }
+
+#ifdef SNAKE_X86
+    // max(x, 0) returns the second operand for NaN and signed zeros, matching `x > 0 ? x : 0`
+
+    __m128d expSse2(__m128d x) {
+        x = _mm_min_pd(_mm_max_pd(x, _mm_set1_pd(-fastmath::ExpLimit)), _mm_set1_pd(fastmath::ExpLimit));
+        __m128d magic = _mm_set1_pd(fastmath::RoundMagic);
+        __m128d shifted = _mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(fastmath::Log2e)), magic);
+        __m128d n = _mm_sub_pd(shifted, magic);
+        __m128d g = _mm_sub_pd(x, _mm_mul_pd(n, _mm_set1_pd(fastmath::Ln2)));
+        __m128d p = _mm_set1_pd(1.0 / 5040.0);
+        p = _mm_add_pd(_mm_mul_pd(p, g), _mm_set1_pd(1.0 / 720.0));
+        p = _mm_add_pd(_mm_mul_pd(p, g), _mm_set1_pd(1.0 / 120.0));
+        p = _mm_add_pd(_mm_mul_pd(p, g), _mm_set1_pd(1.0 / 24.0));
+        p = _mm_add_pd(_mm_mul_pd(p, g), _mm_set1_pd(1.0 / 6.0));
+        p = _mm_add_pd(_mm_mul_pd(p, g), _mm_set1_pd(0.5));
+        p = _mm_add_pd(_mm_mul_pd(p, g), _mm_set1_pd(1.0));
+        p = _mm_add_pd(_mm_mul_pd(p, g), _mm_set1_pd(1.0));
+        __m128i bits = _mm_slli_epi64(_mm_add_epi64(_mm_castpd_si128(shifted), _mm_set1_epi64x(1023)), 52);
+        return _mm_mul_pd(p, _mm_castsi128_pd(bits));
+    }
+
+    void kernelSse2(ActivationType type, ActivationMode mode, double *values, size_t n) {
+        if (type == ActivationType::Identity) return;
+        if (type == ActivationType::ReLU) {
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+                _mm_storeu_pd(values + i, _mm_max_pd(_mm_loadu_pd(values + i), _mm_setzero_pd()));
+            return reluScalar(values, n, i);
+        }
+        if (mode == ActivationMode::Exact) return exactScalar(type, values, n);
+
+        const __m128d one = _mm_set1_pd(1.0);
+        size_t i = 0;
+        if (type == ActivationType::Tanh) {
+            const __m128d limit = _mm_set1_pd(fastmath::TanhLimit);
+            for (; i + 2 <= n; i += 2) {
+                __m128d x = _mm_min_pd(_mm_max_pd(_mm_loadu_pd(values + i), _mm_sub_pd(_mm_setzero_pd(), limit)), limit);
+                __m128d e = expSse2(_mm_add_pd(x, x));
+                _mm_storeu_pd(values + i, _mm_sub_pd(one, _mm_div_pd(_mm_set1_pd(2.0), _mm_add_pd(e, one))));
+            }
+        } else {
+            const __m128d limit = _mm_set1_pd(fastmath::SigmoidLimit);
+            for (; i + 2 <= n; i += 2) {
+                __m128d x = _mm_min_pd(_mm_max_pd(_mm_loadu_pd(values + i), _mm_sub_pd(_mm_setzero_pd(), limit)), limit);
+                __m128d e = expSse2(_mm_sub_pd(_mm_setzero_pd(), x));
+                _mm_storeu_pd(values + i, _mm_div_pd(one, _mm_add_pd(one, e)));
+            }
+        }
+        fastScalar(type, values, n, i);
+    }
+
+    // Same operations as fastmath::exp, without fused multiply-adds, so the bits match the tail
+    __attribute__((target("avx2")))
+    __m256d expAvx2(__m256d x) {
+        x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-fastmath::ExpLimit)), _mm256_set1_pd(fastmath::ExpLimit));
+        __m256d magic = _mm256_set1_pd(fastmath::RoundMagic);
+        __m256d shifted = _mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(fastmath::Log2e)), magic);
+        __m256d n = _mm256_sub_pd(shifted, magic);
+        __m256d g = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(fastmath::Ln2)));
+        __m256d p = _mm256_set1_pd(1.0 / 5040.0);
+        p = _mm256_add_pd(_mm256_mul_pd(p, g), _mm256_set1_pd(1.0 / 720.0));
+        p = _mm256_add_pd(_mm256_mul_pd(p, g), _mm256_set1_pd(1.0 / 120.0));
+        p = _mm256_add_pd(_mm256_mul_pd(p, g), _mm256_set1_pd(1.0 / 24.0));
+        p = _mm256_add_pd(_mm256_mul_pd(p, g), _mm256_set1_pd(1.0 / 6.0));
+        p = _mm256_add_pd(_mm256_mul_pd(p, g), _mm256_set1_pd(0.5));
+        p = _mm256_add_pd(_mm256_mul_pd(p, g), _mm256_set1_pd(1.0));
+        p = _mm256_add_pd(_mm256_mul_pd(p, g), _mm256_set1_pd(1.0));
+        __m256i bits = _mm256_slli_epi64(_mm256_add_epi64(_mm256_castpd_si256(shifted), _mm256_set1_epi64x(1023)), 52);
+        return _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+    }
+
+    __attribute__((target("avx2")))
+    void kernelAvx2(ActivationType type, ActivationMode mode, double *values, size_t n) {
+        if (type == ActivationType::Identity) return;
+        if (type == ActivationType::ReLU) {
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm256_storeu_pd(values + i, _mm256_max_pd(_mm256_loadu_pd(values + i), _mm256_setzero_pd()));
+            return reluScalar(values, n, i);
+        }
+        if (mode == ActivationMode::Exact) return exactScalar(type, values, n);
+
+        const __m256d one = _mm256_set1_pd(1.0);
+        size_t i = 0;
+        if (type == ActivationType::Tanh) {
+            const __m256d limit = _mm256_set1_pd(fastmath::TanhLimit);
+            for (; i + 4 <= n; i += 4) {
+                __m256d x = _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(values + i), _mm256_sub_pd(_mm256_setzero_pd(), limit)), limit);
+                __m256d e = expAvx2(_mm256_add_pd(x, x));
+                _mm256_storeu_pd(values + i, _mm256_sub_pd(one, _mm256_div_pd(_mm256_set1_pd(2.0), _mm256_add_pd(e, one))));
+            }
+        } else {
+            const __m256d limit = _mm256_set1_pd(fastmath::SigmoidLimit);
+            for (; i + 4 <= n; i += 4) {
+                __m256d x = _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(values + i), _mm256_sub_pd(_mm256_setzero_pd(), limit)), limit);
+                __m256d e = expAvx2(_mm256_sub_pd(_mm256_setzero_pd(), x));
+                _mm256_storeu_pd(values + i, _mm256_div_pd(one, _mm256_add_pd(one, e)));
+            }
+        }
+        fastScalar(type, values, n, i);
+    }
+#else
+    // Every x86-64 CPU has SSE2, so only other targets fall back to scalar code
+    void kernelScalar(ActivationType type, ActivationMode mode, double *values, size_t n) {
+        if (type == ActivationType::Identity) return;
+        if (type == ActivationType::ReLU) return reluScalar(values, n, 0);
+        if (mode == ActivationMode::Exact) return exactScalar(type, values, n);
+        fastScalar(type, values, n, 0);
+    }
+#endif
+
+    using Kernel = void (*)(ActivationType, ActivationMode, double *, size_t);
+
+    struct KernelChoice {
+        Kernel kernel;
+        const char *name;
+    };
+
+    KernelChoice chooseKernel() {
+#ifdef SNAKE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return {kernelAvx2, "avx2"};
+        return {kernelSse2, "sse2"};
+#else
+        return {kernelScalar, "scalar"};
+#endif
+    }
+
+    const KernelChoice &kernelChoice() {
+        static const KernelChoice choice = chooseKernel();
+        return choice;
+    }
+}
+
+void setActivationMode(ActivationMode mode) {
+    activationMode.store(mode, std::memory_order_relaxed);
+}
+
+ActivationMode getActivationMode() {
+    return activationMode.load(std::memory_order_relaxed);
+}
+
+const char *getActivationKernelName() {
+    return kernelChoice().name;
+}
+
+void activateArray(ActivationType activationType, double *values, size_t n) {
+    kernelChoice().kernel(activationType, getActivationMode(), values, n);
+}
@@ -0,0 +1,145 @@
+#include "Model/BatchEvaluator.h"
+#include <unordered_map>
+#include <stdexcept>
+
+void BatchEvaluator::assign(const std::vector<Phenotype *> &phenotypes) {
+    phenotypes_ = phenotypes;
+    buckets_.clear();
+    singletons_.clear();
+    stats_ = BatchStats{};
+    stats_.genomes = static_cast<int>(phenotypes.size());
+    if (phenotypes.empty())
+        return;
+
+    inputCount_ = phenotypes.front()->getInputCount();
+    outputCount_ = phenotypes.front()->getOutputCount();
+
+    // Hash first, then confirm equality inside the chain to survive collisions
+    std::unordered_map<size_t, std::vector<int>> byHash;
+    std::vector<Bucket> groups;
+    for (int i = 0; i < static_cast<int>(phenotypes.size()); ++i) {
+        const Phenotype *p = phenotypes[i];
+        if (p->getInputCount() != inputCount_ || p->getOutputCount() != outputCount_)
+            throw std::invalid_argument("Phenotype shape mismatch");
+        if (p->getPrecision() != Precision::Double)
+            throw std::invalid_argument("Batch evaluation needs Double phenotypes");
+
+        auto &chain = byHash[p->getTopologyHash()];
+        bool placed = false;
+        for (int g : chain) {
+            if (groups[g].shape->hasSameTopology(*p)) {
+                groups[g].members.push_back(i);
+                placed = true;
+                break;
+            }
+        }
+        if (!placed) {
+            chain.push_back(static_cast<int>(groups.size()));
+            Bucket bucket;
+            bucket.shape = p;
+            bucket.members.push_back(i);
+            groups.push_back(std::move(bucket));
+        }
+    }
+
+    for (auto &bucket : groups) {
+        if (bucket.members.size() == 1) {
+            singletons_.push_back(bucket.members.front());
+            continue;
+        }
+
+        const Phenotype &shape = *bucket.shape;
+        size_t lanes = bucket.members.size();
+        int edges = shape.getEdgeCount();
+        int computed = static_cast<int>(shape.getPlan()->activation.size());
+        bucket.weight.resize(edges * lanes);
+        int constants = shape.getConstantCount();
+        bucket.bias.resize(computed * lanes);
+        bucket.seed.resize(computed * lanes);
+        bucket.values.assign(shape.getNodeCount() * lanes, 0.0);
+        for (size_t l = 0; l < lanes; ++l) {
+            const Phenotype &p = *phenotypes[bucket.members[l]];
+            for (int e = 0; e < edges; ++e) bucket.weight[e * lanes + l] = p.getWeight(e);
+            for (int n = 0; n < computed; ++n) {
+                bucket.bias[n * lanes + l] = p.getBias(n);
+                bucket.seed[n * lanes + l] = p.getSeed(n);
+            }
+            for (int c = 0; c < constants; ++c) bucket.values[(inputCount_ + c) * lanes + l] = p.getConstant(c);
+        }
+        buckets_.push_back(std::move(bucket));
+    }
+
+    stats_.buckets = static_cast<int>(buckets_.size());
+    stats_.singletons = static_cast<int>(singletons_.size());
+    int groupCount = stats_.buckets + stats_.singletons;
+    stats_.meanBucketSize = static_cast<double>(stats_.genomes) / groupCount;
+}
+
+void BatchEvaluator::evaluate(const double *inputs, double *outputs, const uint8_t *active) {
+    rowIn_.resize(inputCount_);
+    for (auto &bucket : buckets_) {
+        size_t live = 0;
+        if (active) {
+            for (int m : bucket.members) live += active[m] != 0;
+            if (live == 0) continue;
+        } else {
+            live = bucket.members.size();
+        }
+
+        // A mostly idle bucket is cheaper to run genome by genome
+        if (live * 4 < bucket.members.size()) {
+            for (int m : bucket.members) {
+                if (!active[m]) continue;
+                rowIn_.assign(inputs + m * inputCount_, inputs + (m + 1) * inputCount_);
+                phenotypes_[m]->activate(rowIn_, rowOut_);
+                std::copy(rowOut_.begin(), rowOut_.end(), outputs + m * outputCount_);
+            }
+            continue;
+        }
+        evaluateBucket(bucket, inputs, outputs, active);
+    }
+
+    for (int m : singletons_) {
+        if (active && !active[m]) continue;
+        rowIn_.assign(inputs + m * inputCount_, inputs + (m + 1) * inputCount_);
+        phenotypes_[m]->activate(rowIn_, rowOut_);
+        std::copy(rowOut_.begin(), rowOut_.end(), outputs + m * outputCount_);
+    }
+}
+
+void BatchEvaluator::evaluateBucket(Bucket &bucket, const double *inputs, double *outputs, const uint8_t *active) {
+    const PhenotypePlan &plan = *bucket.shape->getPlan();
+    const size_t lanes = bucket.members.size();
+    const int *members = bucket.members.data();
+    double *values = bucket.values.data();
+
+    for (int i = 0; i < inputCount_; ++i) {
+        double *row = values + i * lanes;
+        for (size_t l = 0; l < lanes; ++l) row[l] = inputs[members[l] * inputCount_ + i];
+    }
+
+    // Same per-lane operation order as Phenotype::activate, so results match exactly
+    const int computed = static_cast<int>(plan.activation.size());
+    const int base = plan.computedBase();
+    for (int n = 0; n < computed; ++n) {
+        double *out = values + (base + n) * lanes;
+        const double *seed = bucket.seed.data() + n * lanes;
+        for (size_t l = 0; l < lanes; ++l) out[l] = seed[l];
+        for (int e = plan.inStart[n]; e < plan.inStart[n + 1]; ++e) {
+            const double *src = values + plan.inSource[e] * lanes;
+            const double *w = bucket.weight.data() + e * lanes;
+            for (size_t l = 0; l < lanes; ++l) out[l] += src[l] * w[l];
+        }
+        const double *bias = bucket.bias.data() + n * lanes;
+        for (size_t l = 0; l < lanes; ++l) out[l] += bias[l];
+        activateArray(plan.activation[n], out, lanes);
+    }
+
+    for (int o = 0; o < outputCount_; ++o) {
+        const double *row = values + plan.outputIndex[o] * lanes;
+        for (size_t l = 0; l < lanes; ++l) {
+            if (active && !active[members[l]]) continue;
+            outputs[members[l] * outputCount_ + o] = row[l];
+        }
+    }
+}
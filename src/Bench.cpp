@@ -0,0 +1,1095 @@
+#include "SnakeGame/Game.h"
+#include "SnakeGame/ModelInputProvider.h"
+#include "SnakeGame/ModelPolicy.h"
+#include "Model/Model.h"
+#include "Model/InnovationRegistry.h"
+#include "Model/Population.h"
+#include "SnakeGame/VectorEnv.h"
+#include "SnakeGame/Sensors.h"
+#include "SnakeGame/Board.h"
+#include "Model/BatchEvaluator.h"
+#include "Model/NativeCodegen.h"
+#include "SnakeGame/NativeInputProvider.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <cstdlib>
+#include <random>
+#include <atomic>
+#include <new>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <sstream>
+#include <filesystem>
+#include <omp.h>
+
+// Every heap allocation in the process goes through here so `alloc` can count them, in every
+// plain, array and aligned form
+namespace {
+    std::atomic<long> allocations{0};
+
+    void *countedAlloc(std::size_t size, std::size_t alignment) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        size = size ? size : 1;
+        void *p = alignment > alignof(std::max_align_t)
+                  ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                  : std::malloc(size);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+}
+
+void *operator new(std::size_t size) { return countedAlloc(size, 0); }
+
+void *operator new[](std::size_t size) { return countedAlloc(size, 0); }
+
+void *operator new(std::size_t size, std::align_val_t align) {
+    return countedAlloc(size, static_cast<std::size_t>(align));
+}
+
+void *operator new[](std::size_t size, std::align_val_t align) {
+    return countedAlloc(size, static_cast<std::size_t>(align));
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+    int argmax(const std::vector<double> &outputs) {
+        return static_cast<int>(std::distance(outputs.begin(), std::max_element(outputs.begin(), outputs.end())));
+    }
+
+    std::vector<std::unique_ptr<Model>> loadModels(const std::vector<std::string> &files, int fallbackCount) {
+        std::vector<std::unique_ptr<Model>> models;
+        for (const auto &file: files) {
+            std::ifstream in(file, std::ios::binary);
+            if (!in) {
+                std::cerr << "cannot open " << file << std::endl;
+                continue;
+            }
+            auto model = std::make_unique<Model>(11, 3);
+            model->load(in);
+            models.push_back(std::move(model));
+        }
+        if (files.empty()) {
+            for (int i = 0; i < fallbackCount; ++i) models.push_back(std::make_unique<Model>(11, 3));
+        }
+        return models;
+    }
+
+    // Random genomes with some evolved structure: repeated crossover plus mutation
+    std::vector<std::unique_ptr<Model>> evolveModels(int count, int rounds) {
+        std::vector<std::unique_ptr<Model>> models;
+        for (int i = 0; i < count; ++i) models.push_back(std::make_unique<Model>(11, 3));
+        CounterRng rng(randomSeed());
+        for (int r = 0; r < rounds; ++r) {
+            for (int i = 0; i < count; ++i) {
+                auto child = models[i]->crossover(models[rng() % count].get());
+                child->mutate();
+                models[i] = std::move(child);
+            }
+        }
+        return models;
+    }
+
+    // ---------------------------------------------------------------- precision
+
+    struct PrecisionStats {
+        long steps = 0;
+        long disagreements[3] = {0, 0, 0};
+        double maxError[3] = {0.0, 0.0, 0.0};
+    };
+
+    // Plays with the double phenotype and shadows every decision in the lower precisions
+    class PrecisionProbe : public InputProvider {
+    public:
+        PrecisionProbe(Model *model, PrecisionStats *stats) : model_(model), stats_(stats) {
+            const Phenotype &reference = model->getPhenotype();
+            for (auto precision: {Precision::Float, Precision::Int8}) {
+                Phenotype lowered = reference;
+                lowered.setPrecision(precision);
+                lowered_.push_back(std::move(lowered));
+            }
+        }
+
+        Direction getInput(std::vector<double> &inputs) override {
+            model_->getPhenotype().activate(inputs, reference_);
+            int decision = argmax(reference_);
+            stats_->steps++;
+            for (size_t i = 0; i < lowered_.size(); ++i) {
+                lowered_[i].activate(inputs, outputs_);
+                if (argmax(outputs_) != decision) stats_->disagreements[i + 1]++;
+                for (size_t o = 0; o < outputs_.size(); ++o)
+                    stats_->maxError[i + 1] = std::max(stats_->maxError[i + 1], std::abs(outputs_[o] - reference_[o]));
+            }
+            return static_cast<Direction>(decision);
+        }
+
+    private:
+        Model *model_;
+        PrecisionStats *stats_;
+        std::vector<Phenotype> lowered_;
+        std::vector<double> reference_, outputs_;
+    };
+
+    int runPrecision(int episodes, const std::vector<std::string> &files) {
+        auto models = loadModels(files, 50);
+        PrecisionStats stats;
+        for (auto &model: models) {
+            model->compile(Precision::Double);
+            Game game(800, 800, nullptr, std::make_unique<PrecisionProbe>(model.get(), &stats));
+            for (int e = 0; e < episodes; ++e) game.start(0);
+        }
+
+        const char *names[3] = {"double", "float", "int8"};
+        std::cout << "models: " << models.size() << " steps: " << stats.steps << std::endl;
+        for (int i = 1; i < 3; ++i) {
+            double rate = stats.steps ? 100.0 * stats.disagreements[i] / stats.steps : 0.0;
+            std::cout << std::setw(6) << names[i] << "  argmax disagreements: " << stats.disagreements[i]
+                      << " (" << std::setprecision(4) << rate << "%)  max output error: "
+                      << stats.maxError[i] << std::endl;
+        }
+        return 0;
+    }
+
+    // ---------------------------------------------------------------- incremental
+
+    // Plays with incremental evaluation and checks every step against a full evaluation
+    class IncrementalProbe : public InputProvider {
+    public:
+        IncrementalProbe(Model *model, long *mismatches) : model_(model), mismatches_(mismatches) {}
+
+        Direction getInput(std::vector<double> &inputs) override {
+            Phenotype &phenotype = model_->getPhenotype();
+            phenotype.activateIncremental(state_, inputs, incremental_);
+            phenotype.activate(inputs, full_);
+            if (incremental_ != full_) (*mismatches_)++;
+            return static_cast<Direction>(argmax(incremental_));
+        }
+
+        void reset() override { state_.reset(); }
+
+        IncrementalState state_;
+
+    private:
+        Model *model_;
+        long *mismatches_;
+        std::vector<double> incremental_, full_;
+    };
+
+    int runIncremental(int episodes, const std::vector<std::string> &files) {
+        auto models = files.empty() ? evolveModels(50, 300) : loadModels(files, 0);
+        long macs = 0, fullMacs = 0, mismatches = 0;
+        int nodes = 0;
+        for (auto &model: models) {
+            nodes += model->getPhenotype().getNodeCount();
+            auto probe = std::make_unique<IncrementalProbe>(model.get(), &mismatches);
+            IncrementalProbe *raw = probe.get();
+            Game game(800, 800, nullptr, std::move(probe));
+            for (int e = 0; e < episodes; ++e) game.start(0);
+            macs += raw->state_.macs;
+            fullMacs += raw->state_.fullMacs;
+        }
+
+        std::cout << "models: " << models.size() << " mean nodes: " << static_cast<double>(nodes) / models.size()
+                  << std::endl;
+        std::cout << "multiply-adds full: " << fullMacs << " incremental: " << macs << " saved: "
+                  << std::setprecision(4) << (fullMacs ? 100.0 * (fullMacs - macs) / fullMacs : 0.0) << "%"
+                  << " mismatching steps: " << mismatches << std::endl;
+        return 0;
+    }
+
+    // ---------------------------------------------------------------- alloc
+
+    // Counts the heap allocations made inside ModelInputProvider::getInput
+    class AllocProbe : public InputProvider {
+    public:
+        explicit AllocProbe(Model *model) : inner_(model, false) {}
+
+        Direction getInput(std::vector<double> &inputs) override {
+            long before = allocations.load(std::memory_order_relaxed);
+            Direction decision = inner_.getInput(inputs);
+            if (counting_) {
+                allocations_ += allocations.load(std::memory_order_relaxed) - before;
+                steps_++;
+            }
+            return decision;
+        }
+
+        void reset() override { inner_.reset(); }
+
+        ModelInputProvider inner_;
+        bool counting_ = false;
+        long allocations_ = 0, steps_ = 0;
+    };
+
+    int runAlloc(int episodes, const std::vector<std::string> &files) {
+        auto models = files.empty() ? evolveModels(20, 200) : loadModels(files, 0);
+        struct Mode {
+            const char *name;
+            bool incremental;
+            size_t cacheEntries;
+        };
+        const Mode modes[] = {{"full", false, 0}, {"incremental", true, 0}, {"cached", false, 4096}};
+
+        long failures = 0;
+        for (const auto &mode: modes) {
+            long count = 0, steps = 0;
+            for (auto &model: models) {
+                model->compile();
+                auto probe = std::make_unique<AllocProbe>(model.get());
+                AllocProbe *raw = probe.get();
+                raw->inner_.setIncremental(mode.incremental);
+                raw->inner_.setDecisionCache(mode.cacheEntries);
+                Game game(800, 800, nullptr, std::move(probe));
+                // The first episode sizes the scratch and incremental buffers
+                game.start(0);
+                raw->counting_ = true;
+                for (int e = 0; e < episodes; ++e) game.start(0);
+                count += raw->allocations_;
+                steps += raw->steps_;
+            }
+            failures += count;
+            std::cout << std::setw(12) << mode.name << "  steps: " << steps << " allocations: " << count << std::endl;
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    // ---------------------------------------------------------------- batch
+
+    // Plays with the model and records every sensor vector it sees
+    class Recorder : public InputProvider {
+    public:
+        Recorder(Model *model, std::vector<double> *states) : model_(model), states_(states) {}
+
+        Direction getInput(std::vector<double> &inputs) override {
+            states_->insert(states_->end(), inputs.begin(), inputs.end());
+            return static_cast<Direction>(argmax(model_->feedForward(inputs)));
+        }
+
+    private:
+        Model *model_;
+        std::vector<double> *states_;
+    };
+
+    int runBatch(int episodes, const std::vector<std::string> &files) {
+        auto models = files.empty() ? evolveModels(20, 200) : loadModels(files, 0);
+        using Clock = std::chrono::steady_clock;
+        std::vector<std::vector<double>> states(models.size());
+        for (size_t i = 0; i < models.size(); ++i) {
+            Game game(800, 800, nullptr, std::make_unique<Recorder>(models[i].get(), &states[i]));
+            for (int e = 0; e < episodes; ++e) game.start(0);
+        }
+
+        // Both activation modes promise the same bits from the batch as from the loop
+        long failures = 0;
+        for (ActivationMode mode: {ActivationMode::Exact, ActivationMode::Fast}) {
+            setActivationMode(mode);
+            double loopSeconds = 0.0, batchSeconds = 0.0;
+            size_t rows = 0;
+            long mismatches = 0;
+            for (size_t i = 0; i < models.size(); ++i) {
+                Model &model = *models[i];
+                size_t n = states[i].size() / 11;
+                std::vector<double> looped(n * 3), batched(n * 3);
+                model.compile();
+                auto t0 = Clock::now();
+                for (size_t r = 0; r < n; ++r) model.activate(&states[i][r * 11], 11, &looped[r * 3], 3);
+                auto t1 = Clock::now();
+                model.activateBatch(states[i].data(), n, batched.data());
+                auto t2 = Clock::now();
+
+                loopSeconds += std::chrono::duration<double>(t1 - t0).count();
+                batchSeconds += std::chrono::duration<double>(t2 - t1).count();
+                for (size_t r = 0; r < n; ++r)
+                    if (std::memcmp(&looped[r * 3], &batched[r * 3], 3 * sizeof(double)) != 0) mismatches++;
+                rows += n;
+            }
+            failures += mismatches;
+
+            std::cout << (mode == ActivationMode::Exact ? "exact" : "fast") << "  models: " << models.size()
+                      << " states: " << rows << "  per-state loop: " << 1e9 * loopSeconds / rows
+                      << " ns/state  batch: " << 1e9 * batchSeconds / rows << " ns/state  mismatching states: "
+                      << mismatches << std::endl;
+        }
+        setActivationMode(ActivationMode::Exact);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // ---------------------------------------------------------------- native
+
+    // Mean score of episodes games from the streams of base, played through provider
+    double playProvider(std::unique_ptr<InputProvider> provider, int episodes, const CounterRng &base) {
+        Game game(800, 800, nullptr, std::move(provider));
+        double total = 0.0;
+        for (int e = 0; e < episodes; ++e) {
+            game.setRng(base.split(e));
+            game.start(0);
+            total += game.getScore();
+        }
+        return total / episodes;
+    }
+
+    // Compiled modules against the interpreter: snake_forward must give the phenotype's outputs
+    // bit for bit on recorded states and ModelPolicy's decision, and NativeInputProvider the
+    // interpreter's scores. Then, with no compiler and an empty cache, every provider must fall
+    // back to the interpreter and still score the same.
+    int runNative(int episodes, const std::vector<std::string> &files) {
+        auto models = files.empty() ? evolveModels(5, 200) : loadModels(files, 0);
+        CounterRng base(randomSeed());
+
+        long unloaded = 0, outputMismatches = 0, decisionMismatches = 0, scoreMismatches = 0;
+        size_t rows = 0;
+        for (size_t i = 0; i < models.size(); ++i) {
+            Model &model = *models[i];
+            std::vector<double> states;
+            {
+                Game game(800, 800, nullptr, std::make_unique<Recorder>(&model, &states));
+                for (int e = 0; e < episodes; ++e) game.start(0);
+            }
+            model.compile(Precision::Double);
+            std::string error;
+            NativeModule module = loadNativeModule(model.getPhenotype(), &error);
+            if (!module.forward) {
+                std::cerr << "model " << i << ": " << error << std::endl;
+                unloaded++;
+                continue;
+            }
+
+            ModelPolicy policy(&model);
+            std::vector<double> inputs(11), interpreted(3);
+            double native[3];
+            for (size_t r = 0; r < states.size() / 11; ++r, ++rows) {
+                inputs.assign(states.begin() + r * 11, states.begin() + (r + 1) * 11);
+                module.forward(inputs.data(), native);
+                model.getPhenotype().activate(inputs, interpreted);
+                outputMismatches += std::memcmp(native, interpreted.data(), sizeof(native)) != 0;
+                int decision = static_cast<int>(std::max_element(native, native + 3) - native);
+                decisionMismatches += decision != static_cast<int>(policy.decide(inputs));
+            }
+            unloadNativeModule(module);
+
+            double interpreter = playProvider(std::make_unique<ModelInputProvider>(&model, false), episodes,
+                                              base.split(i));
+            double compiled = playProvider(std::make_unique<NativeInputProvider>(&model, false), episodes,
+                                           base.split(i));
+            scoreMismatches += compiled != interpreter;
+        }
+        std::cout << "models: " << models.size() << "  not loaded: " << unloaded << "  states: " << rows
+                  << "  output mismatches: " << outputMismatches << "  decision mismatches: "
+                  << decisionMismatches << "  score mismatches: " << scoreMismatches << std::endl;
+
+        // A missing compiler, in a fresh cache so no earlier build can stand in for it
+        std::string previousCxx = std::getenv("SNAKE_CXX") ? std::getenv("SNAKE_CXX") : "";
+        std::string previousCache = std::getenv("XDG_CACHE_HOME") ? std::getenv("XDG_CACHE_HOME") : "";
+        std::string cache = (std::filesystem::temp_directory_path() / "snakebench-native.XXXXXX").string();
+        if (!mkdtemp(cache.data())) {
+            std::cerr << "cannot create " << cache << std::endl;
+            return 1;
+        }
+        setenv("SNAKE_CXX", "/nonexistent", 1);
+        setenv("XDG_CACHE_HOME", cache.c_str(), 1);
+        long native = 0, fallbackMismatches = 0;
+        for (size_t i = 0; i < models.size(); ++i) {
+            auto provider = std::make_unique<NativeInputProvider>(models[i].get(), false);
+            native += provider->isNative();
+            double fallback = playProvider(std::move(provider), episodes, base.split(i));
+            double interpreter = playProvider(std::make_unique<ModelInputProvider>(models[i].get(), false),
+                                              episodes, base.split(i));
+            fallbackMismatches += fallback != interpreter;
+        }
+        previousCxx.empty() ? unsetenv("SNAKE_CXX") : setenv("SNAKE_CXX", previousCxx.c_str(), 1);
+        previousCache.empty() ? unsetenv("XDG_CACHE_HOME") : setenv("XDG_CACHE_HOME", previousCache.c_str(), 1);
+        std::error_code ec;
+        std::filesystem::remove_all(cache, ec);
+        std::cout << "SNAKE_CXX=/nonexistent  native: " << native << "  fallback score mismatches: "
+                  << fallbackMismatches << std::endl;
+
+        long failures = unloaded + outputMismatches + decisionMismatches + scoreMismatches + native +
+                        fallbackMismatches;
+        return failures == 0 ? 0 : 1;
+    }
+
+    // ---------------------------------------------------------------- mutate
+
+    // What Model::mutate did per gene before the mutation kernel
+    void mutateLegacy(const DoubleConfig &config, std::mt19937 &rng, double *values, size_t n) {
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        std::uniform_real_distribution<double> fresh(config.min, config.max);
+        std::uniform_real_distribution<double> delta(-config.mutation_power, config.mutation_power);
+        for (size_t i = 0; i < n; ++i) {
+            if (dist(rng) < config.mutation_rate) {
+                double value = dist(rng) < config.replace_rate ? fresh(rng) : values[i] + delta(rng);
+                values[i] = std::min(config.max, std::max(config.min, value));
+            }
+        }
+    }
+
+    // Share of values per bin of [min, max], plus the share left unchanged
+    std::vector<double> histogram(const std::vector<double> &values, double start, const DoubleConfig &config) {
+        const int bins = 40;
+        std::vector<double> shares(bins + 1, 0.0);
+        for (double v: values) {
+            if (v == start) {
+                shares[bins] += 1.0;
+                continue;
+            }
+            int bin = static_cast<int>((v - config.min) / (config.max - config.min) * bins);
+            shares[std::min(bins - 1, std::max(0, bin))] += 1.0;
+        }
+        for (double &share: shares) share /= static_cast<double>(values.size());
+        return shares;
+    }
+
+    int runMutate(size_t genes) {
+        using Clock = std::chrono::steady_clock;
+        const DoubleConfig config{};
+        const int rounds = 20;
+
+        // Same starting values through both paths, several times over
+        std::vector<double> kernel(genes), legacy(genes);
+        for (size_t i = 0; i < genes; ++i) kernel[i] = legacy[i] = 0.9 * std::sin(static_cast<double>(i));
+        std::vector<uint8_t> mask(genes, 1);
+        CounterRng rng(12345);
+        std::mt19937 gen(12345);
+
+        double kernelSeconds = 0.0, legacySeconds = 0.0;
+        for (int r = 0; r < rounds; ++r) {
+            auto t0 = Clock::now();
+            mutateArray(config, rng, rng.take(static_cast<uint32_t>(3 * genes)), kernel.data(), mask.data(), genes);
+            auto t1 = Clock::now();
+            mutateLegacy(config, gen, legacy.data(), genes);
+            auto t2 = Clock::now();
+            kernelSeconds += std::chrono::duration<double>(t1 - t0).count();
+            legacySeconds += std::chrono::duration<double>(t2 - t1).count();
+        }
+
+        // One round from a fixed value: unchanged share, replacement and step distributions
+        std::vector<double> once(genes, 0.25), onceLegacy(genes, 0.25);
+        mutateArray(config, rng, rng.take(static_cast<uint32_t>(3 * genes)), once.data(), nullptr, genes);
+        mutateLegacy(config, gen, onceLegacy.data(), genes);
+        auto a = histogram(once, 0.25, config), b = histogram(onceLegacy, 0.25, config);
+        auto c = histogram(kernel, 1e9, config), d = histogram(legacy, 1e9, config);
+        double gap = 0.0;
+        for (size_t i = 0; i < a.size(); ++i) gap = std::max({gap, std::abs(a[i] - b[i]), std::abs(c[i] - d[i])});
+
+        // Whole-genome mutation on evolved models
+        auto models = evolveModels(200, 50);
+        size_t modelGenes = 0;
+        for (auto &model: models) modelGenes += model->getNodes().size() + model->getConnections().size();
+        auto t0 = Clock::now();
+        for (int r = 0; r < rounds; ++r)
+            for (auto &model: models) model->mutate();
+        double modelSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        std::cout << "kernel: " << getMutationKernelName() << "  genes: " << genes << " x " << rounds << std::endl;
+        std::cout << "kernel: " << rounds * genes / kernelSeconds / 1e6 << " M genes/s  previous per-gene path: "
+                  << rounds * genes / legacySeconds / 1e6 << " M genes/s" << std::endl;
+        std::cout << "Model::mutate: " << rounds * modelGenes / modelSeconds / 1e6 << " M genes/s over "
+                  << models.size() << " models" << std::endl;
+        std::cout << "largest histogram gap: " << gap << std::endl;
+        return gap < 0.005 ? 0 : 1;
+    }
+
+    // ---------------------------------------------------------------- repro
+
+    // FNV-1a over every genome and fitness of a population
+    uint64_t digest(const Population &population) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        auto add = [&hash](const std::string &bytes) {
+            for (unsigned char c: bytes) hash = (hash ^ c) * 0x100000001b3ULL;
+        };
+        for (const auto &individual: population.getIndividuals()) {
+            std::ostringstream out;
+            individual->save(out);
+            double fitness = individual->getFitness();
+            out.write(reinterpret_cast<const char *>(&fitness), sizeof(fitness));
+            add(out.str());
+        }
+        return hash;
+    }
+
+    uint64_t runSeeded(int size, int generations, uint64_t seed, int threads) {
+        InnovationRegistry::global().reset();
+        omp_set_num_threads(threads);
+        Population population(size, seed);
+        population.evolve(generations);
+        return digest(population);
+    }
+
+    // The same seed must give the same run on any number of threads, and another seed another run
+    int runRepro(int size, int generations) {
+        const uint64_t seed = 20240601;
+        int before = omp_get_max_threads(), threads = std::max(4, before);
+        uint64_t single = runSeeded(size, generations, seed, 1);
+        uint64_t parallel = runSeeded(size, generations, seed, threads);
+        uint64_t again = runSeeded(size, generations, seed, threads);
+        uint64_t other = runSeeded(size, generations, seed + 1, threads);
+        omp_set_num_threads(before);
+
+        std::cout << std::hex << "1 thread: " << single << "  " << std::dec << threads << " threads: "
+                  << std::hex << parallel << "  again: " << again << "  seed + 1: " << other << std::dec
+                  << std::endl;
+        bool ok = single == parallel && parallel == again && other != single;
+        std::cout << (ok ? "reproducible" : "NOT reproducible") << std::endl;
+        return ok ? 0 : 1;
+    }
+
+    // ---------------------------------------------------------------- vecenv
+
+    // One Game per model driven through step(), all of them in lockstep with one batched
+    // network call per tick
+    void runStepped(const std::vector<Model *> &models, const std::vector<CounterRng> &streams, int episodes,
+                    std::vector<double> &scores) {
+        const size_t count = models.size();
+        std::vector<Phenotype *> phenotypes;
+        for (auto *model: models) phenotypes.push_back(&model->getPhenotype());
+        BatchEvaluator evaluator;
+        evaluator.assign(phenotypes);
+
+        std::vector<Game> games;
+        games.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            games.emplace_back(800, 800, nullptr, nullptr);
+            games[i].reset(streams[i].split(0).getKey());
+        }
+        std::vector<int> episode(count, 0);
+        std::vector<uint8_t> live(count, 1);
+        std::vector<double> inputs(count * SensorCount), outputs(count * 3);
+        scores.assign(count, 0.0);
+
+        size_t remaining = count;
+        while (remaining > 0) {
+            for (size_t i = 0; i < count; ++i) {
+                if (!live[i]) continue;
+                const std::vector<double> &observation = games[i].getState().observation;
+                std::copy(observation.begin(), observation.end(), inputs.begin() + i * SensorCount);
+            }
+
+            evaluator.evaluate(inputs.data(), outputs.data(), live.data());
+
+            for (size_t i = 0; i < count; ++i) {
+                if (!live[i]) continue;
+                const double *out = outputs.data() + i * 3;
+                auto action = static_cast<Direction>(std::max_element(out, out + 3) - out);
+                const StepResult &result = games[i].step(action);
+                if (!result.done) continue;
+
+                scores[i] += result.info.score;
+                if (++episode[i] < episodes) {
+                    games[i].reset(streams[i].split(episode[i]).getKey());
+                } else {
+                    scores[i] /= episodes;
+                    live[i] = 0;
+                    remaining--;
+                }
+            }
+        }
+    }
+
+    // VectorEnv and stepped Games against one Game per model on the same episode streams:
+    // every score must match
+    int runVecEnv(int count, int episodes, int generations) {
+        using Clock = std::chrono::steady_clock;
+        // Genomes as evaluate() sees them a few generations into a run
+        Population population(count, randomSeed());
+        population.evolve(generations);
+        std::vector<Model *> raw;
+        std::vector<CounterRng> streams;
+        CounterRng base(randomSeed());
+        for (int i = 0; i < count; ++i) {
+            raw.push_back(population.getIndividuals()[i]->getModel());
+            raw.back()->compile(Precision::Double);
+            streams.push_back(base.split(i));
+        }
+
+        // Best of three, alternating, against a noisy host
+        std::vector<double> lockstep, stepped, serial(count);
+        VectorEnvStats stats;
+        double lockstepSeconds = 1e30, steppedSeconds = 1e30, serialSeconds = 1e30;
+        for (int round = 0; round < 3; ++round) {
+            auto t0 = Clock::now();
+            VectorEnv env(Game::toCells(800), Game::toCells(800));
+            env.run(raw, streams, episodes, lockstep);
+            lockstepSeconds = std::min(lockstepSeconds, std::chrono::duration<double>(Clock::now() - t0).count());
+            stats = env.getStats();
+
+            t0 = Clock::now();
+            runStepped(raw, streams, episodes, stepped);
+            steppedSeconds = std::min(steppedSeconds, std::chrono::duration<double>(Clock::now() - t0).count());
+
+            t0 = Clock::now();
+            for (int i = 0; i < count; ++i) {
+                Game game(800, 800, nullptr, std::make_unique<ModelInputProvider>(raw[i], false));
+                double total = 0.0;
+                for (int e = 0; e < episodes; ++e) {
+                    game.setRng(streams[i].split(e));
+                    game.start(0);
+                    total += game.getScore();
+                }
+                serial[i] = total / episodes;
+            }
+            serialSeconds = std::min(serialSeconds, std::chrono::duration<double>(Clock::now() - t0).count());
+        }
+
+        int mismatches = 0;
+        for (int i = 0; i < count; ++i) mismatches += (lockstep[i] != serial[i]) + (stepped[i] != serial[i]);
+
+        std::cout << "models: " << count << "  episodes: " << stats.episodes << "  steps: " << stats.steps
+                  << "  ticks: " << stats.ticks << "  mean live slots: "
+                  << static_cast<double>(stats.steps) / stats.ticks << std::endl;
+        std::cout << "lockstep: " << stats.steps / lockstepSeconds / 1e6 << " M steps/s  one Game per model: "
+                  << stats.steps / serialSeconds / 1e6 << " M steps/s  speedup: "
+                  << serialSeconds / lockstepSeconds << "x" << std::endl;
+        std::cout << "Game::step in lockstep: " << stats.steps / steppedSeconds / 1e6 << " M steps/s  speedup: "
+                  << serialSeconds / steppedSeconds << "x" << std::endl;
+        std::cout << "score mismatches: " << mismatches << std::endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    // ---------------------------------------------------------------- geometry
+
+    // Seeded episodes of every model on a size x size board; returns seconds, adds up steps
+    double playBoard(const std::vector<Model *> &models, int size, int episodes, const CounterRng &base,
+                     std::vector<double> &scores, long &steps) {
+        using Clock = std::chrono::steady_clock;
+        scores.clear();
+        steps = 0;
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < models.size(); ++i) {
+            Game game(size * 20, size * 20, nullptr, std::make_unique<ModelInputProvider>(models[i], false));
+            for (int e = 0; e < episodes; ++e) {
+                game.setRng(base.split(i).split(e));
+                game.start(0);
+                scores.push_back(game.getScore());
+                steps += game.getState().info.steps;
+            }
+        }
+        return std::chrono::duration<double>(Clock::now() - t0).count();
+    }
+
+    // Each board size with its FixedBoard code against the DynamicBoard code on the same episodes
+    int runGeometry(int episodes) {
+        Population population(200, randomSeed());
+        population.evolve(3);
+        std::vector<Model *> models;
+        for (const auto &individual: population.getIndividuals()) {
+            models.push_back(individual->getModel());
+            models.back()->compile(Precision::Double);
+        }
+        CounterRng base(randomSeed());
+
+        long mismatches = 0;
+        for (int size: {20, 40, 64, 30}) {
+            std::vector<double> fixed, dynamic;
+            long steps = 0;
+            double fixedSeconds = 1e30, dynamicSeconds = 1e30;
+            // A warm-up pass builds the food-angle tables, then best of five each, alternating
+            playBoard(models, size, 1, base, fixed, steps);
+            for (int round = 0; round < 5; ++round) {
+                setBoardDispatch(BoardDispatch::Specialized);
+                fixedSeconds = std::min(fixedSeconds, playBoard(models, size, episodes, base, fixed, steps));
+                setBoardDispatch(BoardDispatch::Dynamic);
+                dynamicSeconds = std::min(dynamicSeconds, playBoard(models, size, episodes, base, dynamic, steps));
+            }
+            setBoardDispatch(BoardDispatch::Specialized);
+            for (size_t i = 0; i < fixed.size(); ++i) mismatches += fixed[i] != dynamic[i];
+
+            std::cout << size << " x " << size << (size == 30 ? " (no specialization)" : "") << "  steps: " << steps
+                      << "  fixed: " << steps / fixedSeconds / 1e6 << " M steps/s  dynamic: "
+                      << steps / dynamicSeconds / 1e6 << " M steps/s  speedup: " << dynamicSeconds / fixedSeconds
+                      << "x" << std::endl;
+        }
+        std::cout << "score mismatches: " << mismatches << std::endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    // ---------------------------------------------------------------- policy
+
+    // Seeded episodes of every model through ModelInputProvider and start(epsilon), or through a
+    // ModelPolicy and start(policy); returns seconds, adds up steps
+    double playPolicy(const std::vector<Model *> &models, bool virtualCall, bool incremental, int episodes,
+                      const CounterRng &base, std::vector<double> &scores, long &steps) {
+        using Clock = std::chrono::steady_clock;
+        scores.clear();
+        steps = 0;
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < models.size(); ++i) {
+            auto provider = std::make_unique<ModelInputProvider>(models[i], false);
+            provider->setIncremental(incremental);
+            ModelPolicy policy(models[i]);
+            policy.setIncremental(incremental);
+            Game game(800, 800, nullptr, virtualCall ? std::move(provider) : nullptr);
+            for (int e = 0; e < episodes; ++e) {
+                game.setRng(base.split(i).split(e));
+                if (virtualCall)
+                    game.start(0);
+                else
+                    game.start(policy);
+                scores.push_back(game.getScore());
+                steps += game.getState().info.steps;
+            }
+        }
+        return std::chrono::duration<double>(Clock::now() - t0).count();
+    }
+
+    // The static policy path against the virtual InputProvider path on the same episodes
+    int runPolicy(int episodes) {
+        Population population(200, randomSeed());
+        population.evolve(3);
+        std::vector<Model *> models;
+        for (const auto &individual: population.getIndividuals()) {
+            models.push_back(individual->getModel());
+            models.back()->compile(Precision::Double);
+        }
+        CounterRng base(randomSeed());
+
+        long mismatches = 0;
+        for (bool incremental: {false, true}) {
+            std::vector<double> direct, virtualScores;
+            long steps = 0;
+            double directSeconds = 1e30, virtualSeconds = 1e30;
+            // A warm-up pass, then best of five each, alternating
+            playPolicy(models, false, incremental, 1, base, direct, steps);
+            for (int round = 0; round < 5; ++round) {
+                directSeconds = std::min(directSeconds,
+                                         playPolicy(models, false, incremental, episodes, base, direct, steps));
+                virtualSeconds = std::min(virtualSeconds,
+                                          playPolicy(models, true, incremental, episodes, base, virtualScores, steps));
+            }
+            for (size_t i = 0; i < direct.size(); ++i) mismatches += direct[i] != virtualScores[i];
+
+            std::cout << std::setw(12) << (incremental ? "incremental" : "full") << "  steps: " << steps
+                      << "  policy: " << directSeconds / steps * 1e9 << " ns/step  virtual: "
+                      << virtualSeconds / steps * 1e9 << " ns/step  saved: "
+                      << (virtualSeconds - directSeconds) / steps * 1e9 << " ns/step" << std::endl;
+        }
+        std::cout << "score mismatches: " << mismatches << std::endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    // ---------------------------------------------------------------- cache
+
+    // Plays through the cached policy and checks every decision against an uncached policy on
+    // the same inputs, recording the decisions taken
+    class CacheProbe {
+    public:
+        CacheProbe(Model *model, size_t entries, std::vector<int> *decisions)
+                : cached_(model), uncached_(model), decisions_(decisions) {
+            cached_.setDecisionCache(entries);
+        }
+
+        Direction decide(std::vector<double> &inputs) {
+            Direction decision = cached_.decide(inputs);
+            wrong_ += decision != uncached_.decide(inputs);
+            decisions_->push_back(static_cast<int>(decision));
+            states_.insert(states_.end(), inputs.begin(), inputs.end());
+            return decision;
+        }
+
+        void reset() {
+            cached_.reset();
+            uncached_.reset();
+        }
+
+        ModelPolicy cached_, uncached_;
+        std::vector<int> *decisions_;
+        std::vector<double> states_;
+        long wrong_ = 0;
+    };
+
+    // Decision cache against uncached play on the same episodes: the same decisions and
+    // scores, every cached decision the one the network takes, and no sensor vector one ulp
+    // off an exact 1 / k ray value hitting the entry of the exact one
+    int runCache(int episodes) {
+        auto models = evolveModels(20, 200);
+        CounterRng base(randomSeed());
+
+        long wrong = 0, sequenceMismatches = 0, scoreMismatches = 0, hits = 0, misses = 0, bypassed = 0;
+        long nudged = 0, nudgedHits = 0, nudgedBypassed = 0;
+        for (size_t i = 0; i < models.size(); ++i) {
+            Model *model = models[i].get();
+            model->compile(Precision::Double);
+            std::vector<int> cachedDecisions, uncachedDecisions;
+            CacheProbe probe(model, 4096, &cachedDecisions);
+            ModelPolicy uncached(model);
+            Game game(800, 800, nullptr, nullptr);
+            for (int e = 0; e < episodes; ++e) {
+                game.setRng(base.split(i).split(e));
+                game.start(probe);
+                double cachedScore = game.getScore();
+
+                struct Recording {
+                    ModelPolicy &policy;
+                    std::vector<int> &decisions;
+
+                    Direction decide(std::vector<double> &inputs) {
+                        decisions.push_back(static_cast<int>(policy.decide(inputs)));
+                        return static_cast<Direction>(decisions.back());
+                    }
+
+                    void reset() { policy.reset(); }
+                } recording{uncached, uncachedDecisions};
+                game.setRng(base.split(i).split(e));
+                game.start(recording);
+                scoreMismatches += cachedScore != game.getScore();
+            }
+            sequenceMismatches += cachedDecisions != uncachedDecisions;
+            wrong += probe.wrong_;
+            const DecisionCache &cache = probe.cached_.getDecisionCache();
+            hits += cache.getHits();
+            misses += cache.getMisses();
+            bypassed += cache.getBypassed();
+
+            // A cache of every state played; one ray one ulp away must never find an entry
+            DecisionCache filled;
+            filled.resize(1 << 16);
+            std::vector<double> inputs;
+            Direction decision;
+            for (size_t r = 0; r < probe.states_.size() / 11; ++r) {
+                inputs.assign(probe.states_.begin() + r * 11, probe.states_.begin() + (r + 1) * 11);
+                if (!filled.lookup(inputs, decision)) filled.store(static_cast<Direction>(cachedDecisions[r]));
+            }
+            filled.resetCounters();
+            for (size_t r = 0; r < probe.states_.size() / 11; ++r) {
+                for (int ray = 0; ray < 9; ++ray) {
+                    inputs.assign(probe.states_.begin() + r * 11, probe.states_.begin() + (r + 1) * 11);
+                    if (inputs[ray] <= 0.0) continue;
+                    inputs[ray] = std::nextafter(inputs[ray], 2.0);
+                    nudged++;
+                    nudgedHits += filled.lookup(inputs, decision);
+                }
+            }
+            nudgedBypassed += filled.getBypassed();
+        }
+
+        long lookups = hits + misses + bypassed;
+        std::cout << "models: " << models.size() << "  decisions: " << lookups << "  hits: " << hits
+                  << "  misses: " << misses << "  bypassed: " << bypassed << "  hit rate: "
+                  << 100.0 * hits / std::max(1L, lookups) << "%" << std::endl;
+        std::cout << "wrong cached decisions: " << wrong << "  decision sequence mismatches: "
+                  << sequenceMismatches << "  score mismatches: " << scoreMismatches << std::endl;
+        std::cout << "one-ulp neighbours: " << nudged << "  bypassed: " << nudgedBypassed << "  hits: "
+                  << nudgedHits << std::endl;
+        return wrong + sequenceMismatches + scoreMismatches + nudgedHits == 0 ? 0 : 1;
+    }
+
+    // ---------------------------------------------------------------- food
+
+    // The rejection sampling FreeCells replaced
+    std::pair<int, int> drawByRejection(const Bitboard &occupied, int cols, int rows, CounterRng &rng) {
+        std::uniform_int_distribution<int> distX(0, cols - 1);
+        std::uniform_int_distribution<int> distY(0, rows - 1);
+        std::pair<int, int> pos;
+        do {
+            pos = {distX(rng), distY(rng)};
+        } while (occupied.test(pos.first, pos.second));
+        return pos;
+    }
+
+    // Food draws on a 40 x 40 board as it fills, one FreeCells draw against rejection sampling,
+    // then random play on boards small enough to fill: every episode must end, and a win must
+    // cover every cell and score every food eaten, the last one not grown yet. A start that fits
+    // the board wins with cells - 3 foods; on 2-wide boards start segments off the board count.
+    // Mutated networks on the same boards must score the same in VectorEnv as in Game.
+    int runFood(int episodes) {
+        using Clock = std::chrono::steady_clock;
+        const int cols = 40, rows = 40, draws = 1 << 16;
+        CounterRng rng(randomSeed());
+
+        std::vector<int> order(cols * rows);
+        for (int i = 0; i < cols * rows; ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        volatile long sink = 0;
+        for (int freeCount: {1596, 400, 40, 4, 1}) {
+            Bitboard occupied;
+            FreeCells free;
+            free.reset(cols * rows);
+            for (int i = 0; i < cols * rows - freeCount; ++i) {
+                occupied.set(order[i] % cols, order[i] / cols);
+                free.take(order[i]);
+            }
+
+            auto t0 = Clock::now();
+            for (int i = 0; i < draws; ++i) sink = sink + Game::drawFood(free, cols, rng).first;
+            double indexed = std::chrono::duration<double>(Clock::now() - t0).count();
+            t0 = Clock::now();
+            for (int i = 0; i < draws; ++i) sink = sink + drawByRejection(occupied, cols, rows, rng).first;
+            double rejection = std::chrono::duration<double>(Clock::now() - t0).count();
+
+            std::cout << std::setw(5) << freeCount << " free  index: " << indexed / draws * 1e9
+                      << " ns/draw  rejection: " << rejection / draws * 1e9 << " ns/draw" << std::endl;
+        }
+
+        long failures = 0, misscored = 0;
+        const std::vector<std::pair<int, int>> boards{{2, 3}, {3, 2}, {2, 4}, {3, 3}, {4, 4}, {5, 5}};
+        for (auto [cols, rows]: boards) {
+            Game game(cols * 20, rows * 20, nullptr, nullptr);
+            const int cells = cols * rows;
+            long wins = 0;
+            std::uniform_int_distribution<int> action(0, 2);
+            for (int e = 0; e < episodes; ++e) {
+                game.reset(rng.split(e).getKey());
+                int eaten = 0;
+                while (!game.getState().done) {
+                    game.step(static_cast<Direction>(action(rng)));
+                    eaten += game.getState().info.ate;
+                }
+                const StepInfo &info = game.getState().info;
+                if (info.won) {
+                    wins++;
+                    failures += info.length < cells || info.length - 3 != eaten;
+                    const int food = eaten;
+                    double efficiency = static_cast<double>(Game::MaxSteps - info.steps) / Game::MaxSteps;
+                    double expected = (food + 1) * (food + 1) + food * efficiency * 2;
+                    misscored += std::abs(info.score - expected) > 1e-9;
+                }
+            }
+            std::cout << cols << " x " << rows << "  episodes: " << episodes << "  wins: " << wins << std::endl;
+        }
+        std::cout << "wrong wins: " << failures << "  wrong win scores: " << misscored << std::endl;
+
+        const int count = 64, perModel = std::max(1, episodes / count);
+        std::vector<std::unique_ptr<Model>> models;
+        std::vector<Model *> raw;
+        std::vector<CounterRng> streams;
+        for (int i = 0; i < count; ++i) {
+            models.push_back(std::make_unique<Model>(SensorCount, 3, rng.split(count + i)));
+            for (int m = 0; m < 30; ++m) models.back()->mutate();
+            models.back()->compile(Precision::Double);
+            raw.push_back(models.back().get());
+            streams.push_back(rng.split(i));
+        }
+        long mismatches = 0;
+        for (auto [cols, rows]: boards) {
+            if (cols * rows > 8) continue;
+            std::vector<double> lockstep;
+            VectorEnv env(cols, rows);
+            env.run(raw, streams, perModel, lockstep);
+            long wins = 0;
+            Game game(cols * 20, rows * 20, nullptr, nullptr);
+            for (int i = 0; i < count; ++i) {
+                ModelPolicy policy(raw[i]);
+                double total = 0.0;
+                for (int e = 0; e < perModel; ++e) {
+                    game.setRng(streams[i].split(e));
+                    game.start(policy);
+                    total += game.getScore();
+                    wins += game.getState().info.won;
+                }
+                mismatches += lockstep[i] != total / perModel;
+            }
+            std::cout << cols << " x " << rows << "  networks: " << count << " x " << perModel
+                      << "  wins: " << wins << std::endl;
+        }
+        std::cout << "VectorEnv score mismatches: " << mismatches << std::endl;
+        return failures == 0 && misscored == 0 && mismatches == 0 ? 0 : 1;
+    }
+
+    void usage() {
+        std::cerr << "usage: snakebench precision [episodes] [model.bin ...]\n"
+                     "       snakebench incremental [episodes] [model.bin ...]\n"
+                     "       snakebench alloc [episodes] [model.bin ...]\n"
+                     "       snakebench batch [episodes] [model.bin ...]\n"
+                     "       snakebench native [episodes] [model.bin ...]\n"
+                     "       snakebench mutate [genes]\n"
+                     "       snakebench repro [population] [generations]\n"
+                     "       snakebench vecenv [models] [episodes] [generations]\n"
+                     "       snakebench geometry [episodes]\n"
+                     "       snakebench policy [episodes]\n"
+                     "       snakebench cache [episodes]\n"
+                     "       snakebench food [episodes]" << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    std::string command = argv[1];
+    std::vector<std::string> args(argv + 2, argv + argc);
+
+    if (command == "precision") {
+        int episodes = args.empty() ? 5 : std::atoi(args[0].c_str());
+        std::vector<std::string> files(args.size() > 1 ? args.begin() + 1 : args.end(), args.end());
+        return runPrecision(episodes, files);
+    }
+    if (command == "incremental") {
+        int episodes = args.empty() ? 5 : std::atoi(args[0].c_str());
+        std::vector<std::string> files(args.size() > 1 ? args.begin() + 1 : args.end(), args.end());
+        return runIncremental(episodes, files);
+    }
+
+    if (command == "alloc") {
+        int episodes = args.empty() ? 5 : std::atoi(args[0].c_str());
+        std::vector<std::string> files(args.size() > 1 ? args.begin() + 1 : args.end(), args.end());
+        return runAlloc(episodes, files);
+    }
+
+    if (command == "batch") {
+        int episodes = args.empty() ? 5 : std::atoi(args[0].c_str());
+        std::vector<std::string> files(args.size() > 1 ? args.begin() + 1 : args.end(), args.end());
+        return runBatch(episodes, files);
+    }
+
+    if (command == "native") {
+        int episodes = args.empty() ? 5 : std::atoi(args[0].c_str());
+        std::vector<std::string> files(args.size() > 1 ? args.begin() + 1 : args.end(), args.end());
+        return runNative(episodes, files);
+    }
+
+    if (command == "mutate") {
+        return runMutate(args.empty() ? 1 << 20 : std::strtoul(args[0].c_str(), nullptr, 10));
+    }
+
+    if (command == "repro") {
+        return runRepro(args.empty() ? 100 : std::atoi(args[0].c_str()),
+                        args.size() < 2 ? 4 : std::atoi(args[1].c_str()));
+    }
+
+    if (command == "vecenv") {
+        return runVecEnv(args.empty() ? 1000 : std::atoi(args[0].c_str()),
+                         args.size() < 2 ? 5 : std::atoi(args[1].c_str()),
+                         args.size() < 3 ? 5 : std::atoi(args[2].c_str()));
+    }
+
+    if (command == "geometry") {
+        return runGeometry(args.empty() ? 5 : std::atoi(args[0].c_str()));
+    }
+
+    if (command == "policy") {
+        return runPolicy(args.empty() ? 5 : std::atoi(args[0].c_str()));
+    }
+
+    if (command == "cache") {
+        return runCache(args.empty() ? 5 : std::atoi(args[0].c_str()));
+    }
+
+    if (command == "food") {
+        return runFood(args.empty() ? 100000 : std::atoi(args[0].c_str()));
+    }
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,14 @@
+#include "SnakeGame/Board.h"
+#include <atomic>
+
+namespace {
+    std::atomic<BoardDispatch> boardDispatch{BoardDispatch::Specialized};
+}
+
+void setBoardDispatch(BoardDispatch dispatch) {
+    boardDispatch.store(dispatch, std::memory_order_relaxed);
+}
+
+BoardDispatch getBoardDispatch() {
+    return boardDispatch.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,78 @@
+#include "SnakeGame/DecisionCache.h"
+#include <cstring>
+#include <cmath>
+
+void DecisionCache::resetCounters() {
+    hits_ = misses_ = bypassed_ = 0;
+}
+
+void DecisionCache::resize(size_t entries) {
+    size_t capacity = 0;
+    if (entries > 0) {
+        capacity = 1;
+        while (capacity < entries) capacity <<= 1;
+    }
+    if (capacity == entries_.size())
+        return;
+    entries_.assign(capacity, Entry{});
+    pendingValid_ = false;
+}
+
+void DecisionCache::clear() {
+    for (auto &entry: entries_) entry.decision = Empty;
+    pendingValid_ = false;
+}
+
+bool DecisionCache::encode(const std::vector<double> &inputs, Entry &key) const {
+    if (inputs.size() != Rays + 2)
+        return false;
+
+    for (int i = 0; i < Rays; ++i) {
+        double v = inputs[i];
+        if (v == 0.0 && !std::signbit(v)) {
+            key.rays[i] = 0;
+            continue;
+        }
+        if (!(v > 0.0)) return false;
+        double k = std::round(1.0 / v);
+        if (k < 1.0 || k > 254.0 || 1.0 / k != v) return false;
+        key.rays[i] = static_cast<uint8_t>(k);
+    }
+    std::memcpy(&key.angle[0], &inputs[Rays], sizeof(uint64_t));
+    std::memcpy(&key.angle[1], &inputs[Rays + 1], sizeof(uint64_t));
+    return true;
+}
+
+bool DecisionCache::lookup(const std::vector<double> &inputs, Direction &decision) {
+    pendingValid_ = false;
+    if (entries_.empty())
+        return false;
+    if (!encode(inputs, pending_)) {
+        ++bypassed_;
+        return false;
+    }
+
+    uint64_t h = pending_.angle[0] * 0x9e3779b97f4a7c15ULL ^ pending_.angle[1] * 0xc2b2ae3d27d4eb4fULL;
+    for (int i = 0; i < Rays; ++i) h = (h ^ pending_.rays[i]) * 0x100000001b3ULL;
+    pendingIndex_ = (h ^ (h >> 29)) & (entries_.size() - 1);
+
+    const Entry &entry = entries_[pendingIndex_];
+    if (entry.decision != Empty &&
+        entry.angle[0] == pending_.angle[0] && entry.angle[1] == pending_.angle[1] &&
+        std::memcmp(entry.rays, pending_.rays, Rays) == 0) {
+        decision = static_cast<Direction>(entry.decision);
+        ++hits_;
+        return true;
+    }
+    ++misses_;
+    pendingValid_ = true;
+    return false;
+}
+
+void DecisionCache::store(Direction decision) {
+    if (!pendingValid_)
+        return;
+    pending_.decision = static_cast<uint8_t>(decision);
+    entries_[pendingIndex_] = pending_;
+    pendingValid_ = false;
+}
@@ -1,197 +1,198 @@
 #include <unistd.h>
 #include <iostream>
 #include "SnakeGame/Game.h"
+#include "SnakeGame/Sensors.h"
 #include "SnakeGame/InputProvider.h"
 #include "SnakeGame/SDLInputProvider.h"
 #include <random>
+#include <stdexcept>
 
 Game::Game(int gridWidth, int gridHeight, Renderer *renderer, std::unique_ptr<InputProvider> inputProvider)
-        : snake_(0, 0),
+        : snake_(gridWidth / CellSize_, gridHeight / CellSize_),
           food_(0, 0),
           inputProvider_(std::move(inputProvider)),
           renderer_(renderer),
           gridW_(gridWidth),
           gridH_(gridHeight),
+          cols_(gridWidth / CellSize_),
+          rows_(gridHeight / CellSize_),
           score_(0),
-          steps_(0) {
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));  // Seed RNG once
-
-    std::uniform_int_distribution<int> distX((gridW_ / CellSize_) * 0.25, (gridW_ / CellSize_) * 0.75);
-    std::uniform_int_distribution<int> distY((gridH_ / CellSize_) * 0.25, (gridH_ / CellSize_) * 0.75);
-    int snakeX = distX(rng_);;
-    int snakeY = distY(rng_);
-    snake_ = Snake(snakeX, snakeY);
+          steps_(0),
+          visits_((gridWidth / CellSize_) * (gridHeight / CellSize_), 0) {
+    placeSnake(cols_ * 0.25, cols_ * 0.75, rows_ * 0.25, rows_ * 0.75);
     generateFood();
 }
 
 
 void Game::start(double epsilon) {
-    reset();
-    bool running = true;
-    std::vector<double> inputs;
-    int steps = 0;
-
-    int leftTurns = 0;
-    int rightTurns = 0;
-    int stepsSinceLastFood = 0;
-
-    std::uniform_real_distribution<double> dist(0.0, 1.0);
-    std::uniform_int_distribution<int> actionDist(0, 2);
-
-    std::deque<std::pair<int, int>> headHistory;
-
-    bool bodyCollided = false;
-    bool wallCollided = false;
-    bool trapped = false;
-    bool looping = false;
+    withBoard(cols_, rows_, [this](auto board) { play(board); });
+}
 
-    int maxSteps = 10000;
+template<typename Board>
+void Game::play(Board board) {
+    reset();
+    while (!result_.done) {
+        Direction dir = inputProvider_->getInput(result_.observation);
+        step(board, dir);
 
-    while (running) {
-        auto head = snake_.getHead();
+        // Optional rendering
+        if (renderer_ != nullptr) {
+            render();
+            usleep(8000);  // Sleep ~8ms
+        }
+    }
+}
 
-        // Track head positions
-        headHistory.push_back(head);
-        if (headHistory.size() > snake_.getBody().size() * 10)
-            headHistory.pop_front();
+template<typename Board>
+void Game::advance(Board board) {
+    auto head = snake_.getHead();
 
-        // Reward for surviving a step
-//        score_ += 0.01;
-        steps++;
-        stepsSinceLastFood++;
+    // Track head positions. Visits per cell over headHistory_ and the number of cells past 3
+    // of them are kept up to date as the window slides; only the last head can be off the
+    // board, and it is never counted
+    auto cell = [board](const std::pair<int, int> &pos) {
+        return board.onBoard(pos.first, pos.second) ? board.cell(pos.first, pos.second) : -1;
+    };
+    headHistory_.push_back(head);
+    int entered = cell(head);
+    if (entered >= 0 && ++visits_[entered] == 4)
+        overVisited_++;
+    if (headHistory_.size() > snake_.getLength() * 10) {
+        int left = cell(headHistory_.front());
+        if (left >= 0 && visits_[left]-- == 4)
+            overVisited_--;
+        headHistory_.pop_front();
+    }
 
-        // Eat food
-        if (head.first == food_.first && head.second == food_.second) {
-            snake_.grow();
-            score_ += 1;
+    steps_++;
+    hunger_++;
+
+    // Eat food
+    result_.info.ate = head.first == food_.first && head.second == food_.second;
+    if (result_.info.ate) {
+        snake_.grow();
+        hunger_ = 0;
+        // Nowhere left for the food: the board is won
+        if (snake_.getFreeCells().empty())
+            result_.info.won = true;
+        else
             generateFood();
-            stepsSinceLastFood = 0;
-        }
-
-        // Gather inputs
-        getInputs(inputs);
-
-        // ε-greedy decision
-//        Direction dir;
-//        if (dist(rng_) < epsilon) {
-//            int action = actionDist(rng_);
-//            if (action == 0) dir = Direction::Left;
-//            else if (action == 1) dir = Direction::Right;
-//            else dir = Direction::None;
-//        } else {
-//            dir = inputProvider_->getInput(inputs);
-//        }
+    }
 
-        Direction dir;
-        dir = inputProvider_->getInput(inputs);
-
-        // Apply direction
-        if (dir != Direction::None) {
-            if (dir == Direction::Left) {
-                snake_.turnLeft();
-                leftTurns++;
-            } else if (dir == Direction::Right) {
-                snake_.turnRight();
-                rightTurns++;
-            }
-        }
+    // Gather inputs
+    result_.observation.resize(SensorCount);
+    senseState(board, snake_.getOccupancy(), head, snake_.getDir(), food_, result_.observation.data());
+    result_.info.steps = steps_;
+    result_.info.length = static_cast<int>(snake_.getLength());
+}
 
-        // Loop/trap detection
-        bool isLooping = false;
-        bool isTrapped = false;
+const StepResult &Game::step(Direction action) {
+    return withBoard(cols_, rows_, [&](auto board) -> const StepResult & { return step(board, action); });
+}
 
-        std::unordered_map<std::pair<int, int>, int, PairHash> positionCounts;
-        for (const auto &pos: headHistory) {
-            positionCounts[pos]++;
-        }
-        for (const auto &[pos, count]: positionCounts) {
-            if (count > 3) {
-                isLooping = true;
-                break;
-            }
-        }
+template<typename Board>
+const StepResult &Game::step(Board board, Direction dir) {
+    if (result_.done)
+        throw std::logic_error("step() after the episode ended");
 
-        int hungerLimit = 100 * std::max((int) snake_.getBody().size() - 2, 1);
-        if (stepsSinceLastFood > hungerLimit && isLooping) {
-            isTrapped = true;
-        }
+    // Apply direction
+    if (dir == Direction::Left) {
+        snake_.turnLeft();
+    } else if (dir == Direction::Right) {
+        snake_.turnRight();
+    }
 
-        // Terminate on loop/trap
-        if (isTrapped) {
-            trapped = true;
-            running = false;
-        } else if (isLooping) {
-            if (renderer_ != nullptr)
-                std::cout << "snake looping" << std::endl;
+    // Loop/trap detection
+    bool isLooping = overVisited_ > 0;
+    int hungerLimit = 100 * std::max((int) snake_.getLength() - 2, 1);
+    bool isTrapped = hunger_ > hungerLimit && isLooping;
 
-            looping = true;
-            running = false;
-        }
+    // Terminate on loop/trap
+    bool running = true;
+    if (isTrapped) {
+        result_.info.trapped = true;
+        running = false;
+    } else if (isLooping) {
+        if (renderer_ != nullptr)
+            std::cout << "snake looping" << std::endl;
+
+        result_.info.looping = true;
+        running = false;
+    }
 
-        // Max steps check
-        if (steps >= maxSteps) {
-            running = false;
-        }
+    // Max steps check
+    if (steps_ >= MaxSteps) {
+        running = false;
+    }
 
-        // Collision check
-        if (snake_.checkCollision(gridW_ / CellSize_, gridH_ / CellSize_, &bodyCollided)) {
-            wallCollided = true;
-            running = false;
-        }
+    // Collision check
+    bool bodyCollided = false;
+    if (snake_.checkCollision(board, &bodyCollided)) {
+        result_.info.collided = true;
+        running = false;
+    }
 
-//        distanceToFood += std::hypot(food_.first - head.first, food_.second - head.second);
+    if (!running) {
+        result_.info.ate = false;
+        endEpisode();
+        return result_;
+    }
 
-        // Move snake
-        if(running)
-            snake_.move();
+    // Move snake
+    snake_.move(board);
+    advance(board);
+    if (result_.info.won)
+        endEpisode();
+    return result_;
+}
 
-        // Optional rendering
-        if (renderer_ != nullptr) {
-            render();
-            usleep(8000);  // Sleep ~8ms
-        }
-    }
+template const StepResult &Game::step(Board20, Direction);
+template const StepResult &Game::step(Board40, Direction);
+template const StepResult &Game::step(Board64, Direction);
+template const StepResult &Game::step(DynamicBoard, Direction);
 
+double Game::scoreEpisode(int length, int growth, int steps, bool looping) {
     // Fitness = food^2 + efficiency_bonus
     // efficiency_bonus = food * (maxSteps - steps) / maxSteps
     // This rewards getting food quickly
 
-    int foodEaten = snake_.getBody().size() - 4;  // Starting size is 4
-    double efficiency = (double)(maxSteps - steps) / maxSteps;
+    int foodEaten = length + growth - 4;  // Starting size is 4
+    double efficiency = (double)(MaxSteps - steps) / MaxSteps;
 
-    score_ = std::pow(foodEaten + 1, 2);  // Base: 1, 4, 9, 16...
-    score_ += foodEaten * efficiency * 2; // Bonus for speed
+    double score = std::pow(foodEaten + 1, 2);  // Base: 1, 4, 9, 16...
+    score += foodEaten * efficiency * 2; // Bonus for speed
 
     if (looping) {
-        score_ *= 0.5;  // Moderate penalty (not too harsh)
+        score *= 0.5;  // Moderate penalty (not too harsh)
     }
+    return score;
 }
 
 
 void Game::generateFood() {
-    int maxX = gridW_ / CellSize_;
-    int maxY = gridH_ / CellSize_;
-
-    std::pair<int, int> pos;
-    const auto &body = snake_.getBody();
+    food_ = drawFood(snake_.getFreeCells(), cols_, rng_);
+}
 
-    do {
-        int foodX = std::rand() % maxX;
-        int foodY = std::rand() % maxY;
-        pos = {foodX, foodY};
-    } while (std::find(body.begin(), body.end(), pos) != body.end());
+void Game::endEpisode() {
+    score_ = scoreEpisode(static_cast<int>(snake_.getLength()), snake_.getGrowth(), steps_,
+                          result_.info.looping);
+    result_.done = true;
+    result_.info.score = score_;
+}
 
-    food_ = pos;
+std::pair<int, int> Game::drawFood(const FreeCells &free, int cols, CounterRng &rng) {
+    std::uniform_int_distribution<int> dist(0, free.size() - 1);
+    int cell = free[dist(rng)];
+    return {cell % cols, cell / cols};
 }
 
 void Game::render() {
     renderer_->clear();
 
     // Draw Snake Body
-    const auto &body = snake_.getBody();
-
     bool first = true;
-    for (const auto &segment: body) {
+    for (size_t i = 0; i < snake_.getLength(); ++i) {
+        auto segment = snake_.getSegment(i);
         int x = segment.first * CellSize_;
         int y = segment.second * CellSize_;
 
@@ -217,71 +218,9 @@ void Game::render() {
 
 
 void Game::getInputs(std::vector<double>& inputs) {
-    inputs.clear();
-
-    auto head = snake_.getHead();
-    auto dir = snake_.getDir();
-    auto& body = snake_.getBody();
-    std::unordered_set<std::pair<int, int>, PairHash> occupied(body.begin() + 1, body.end());
-
-    int gridCols = gridW_ / CellSize_;
-    int gridRows = gridH_ / CellSize_;
-
-    // Calculate left and right directions relative to snake
-    std::pair<int, int> front = dir;
-    std::pair<int, int> left = {dir.second, -dir.first};   // 90 deg counterclockwise
-    std::pair<int, int> right = {-dir.second, dir.first};  // 90 deg clockwise
-
-    std::vector<std::pair<int, int>> relDirs = {front, left, right};
-
-    // Helper: scan in a direction and return (wallDist, bodyDist, foodFound)
-    auto scan = [&](std::pair<int, int> d) -> std::tuple<double, double, double> {
-        int x = head.first;
-        int y = head.second;
-        int steps = 0;
-        double bodyDist = 0.0;
-        double foodFound = 0.0;
-
-        while (true) {
-            x += d.first;
-            y += d.second;
-            steps++;
-
-            // Wall hit
-            if (x < 0 || x >= gridCols || y < 0 || y >= gridRows) {
-                double wallDist = 1.0 / steps;  // Inverse: closer = higher
-                return {wallDist, bodyDist, foodFound};
-            }
-
-            // Body detection (first encounter only)
-            if (bodyDist == 0.0 && occupied.count({x, y})) {
-                bodyDist = 1.0 / steps;  // Inverse: closer = higher
-            }
-
-            // Food detection
-            if (foodFound == 0.0 && x == food_.first && y == food_.second) {
-                foodFound = 1.0;
-            }
-        }
-    };
-
-    // Scan front, left, right
-    for (auto& d : relDirs) {
-        auto [wallDist, bodyDist, foodFound] = scan(d);
-        inputs.push_back(wallDist);
-        inputs.push_back(bodyDist);
-        inputs.push_back(foodFound);
-    }
-
-    // Food angle relative to snake heading
-    int dx = food_.first - head.first;
-    int dy = food_.second - head.second;
-    double angleToFood = std::atan2(dy, dx);
-    double angleSnake = std::atan2(dir.second, dir.first);
-    double relAngle = angleToFood - angleSnake;
-
-    inputs.push_back(std::sin(relAngle));  // -1 to 1
-    inputs.push_back(std::cos(relAngle));  // -1 to 1
+    inputs.resize(SensorCount);
+    senseState(snake_.getOccupancy(), cols_, rows_, snake_.getHead(), snake_.getDir(),
+               food_, inputs.data());
 }
 
 //void Game::getInputs(std::vector<double>& inputs) {
@@ -356,13 +295,45 @@ void Game::getInputs(std::vector<double>& inputs) {
 //}
 
 
-void Game::reset() {
-    int snakeX = std::rand() % (gridW_ / CellSize_);
-    int snakeY = std::rand() % (gridH_ / CellSize_);
-    snake_ = Snake(snakeX, snakeY);
+void Game::placeSnake(int minX, int maxX, int minY, int maxY) {
+    std::uniform_int_distribution<int> distX(minX, maxX);
+    std::uniform_int_distribution<int> distY(minY, maxY);
+    std::uniform_int_distribution<int> distDir(0, 3);
+    int snakeX = distX(rng_);
+    int snakeY = distY(rng_);
+    snake_.reset(snakeX, snakeY, distDir(rng_));
+}
 
-    generateFood();
+const StepResult &Game::reset() {
+    if (inputProvider_)
+        inputProvider_->reset();
+    beginEpisode();
+    return result_;
+}
+
+void Game::beginEpisode() {
+    placeSnake(0, cols_ - 1, 0, rows_ - 1);
+
+    result_.done = false;
+    result_.info = StepInfo{};
+    // Only a board the start segments fill has no cell for the food
+    if (snake_.getFreeCells().empty())
+        result_.info.won = true;
+    else
+        generateFood();
     score_ = 0;
     steps_ = 0;
+    headHistory_.clear();
+    std::fill(visits_.begin(), visits_.end(), 0);
+    overVisited_ = 0;
+    hunger_ = 0;
+    withBoard(cols_, rows_, [this](auto board) { advance(board); });
+    if (result_.info.won)
+        endEpisode();
+}
+
+const StepResult &Game::reset(uint64_t seed) {
+    setRng(CounterRng(seed));
+    return reset();
 }
 
@@ -0,0 +1,59 @@
+#include "Model/InnovationRegistry.h"
+#include <algorithm>
+#include <iterator>
+
+InnovationRegistry &InnovationRegistry::global() {
+    static InnovationRegistry registry;
+    return registry;
+}
+
+int InnovationRegistry::connection(int from, int to) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, added] = connections_.emplace(std::make_pair(from, to), nextConnection_);
+    if (added) nextConnection_++;
+    return it->second;
+}
+
+int InnovationRegistry::find(int from, int to) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = connections_.find({from, to});
+    return it == connections_.end() ? -1 : it->second;
+}
+
+int InnovationRegistry::splitNode(int from, int to) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, added] = splits_.emplace(std::make_pair(from, to), nextNode_);
+    if (added) nextNode_++;
+    return it->second;
+}
+
+int InnovationRegistry::newNode() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nextNode_++;
+}
+
+void InnovationRegistry::reserveNodes(int count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nextNode_ = std::max(nextNode_, count);
+}
+
+void InnovationRegistry::prune(const std::unordered_set<int> &connections, const std::unordered_set<int> &nodes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = connections_.begin(); it != connections_.end();)
+        it = connections.count(it->second) ? std::next(it) : connections_.erase(it);
+    for (auto it = splits_.begin(); it != splits_.end();)
+        it = nodes.count(it->second) ? std::next(it) : splits_.erase(it);
+}
+
+size_t InnovationRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connections_.size() + splits_.size();
+}
+
+void InnovationRegistry::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.clear();
+    splits_.clear();
+    nextConnection_ = 0;
+    nextNode_ = 0;
+}
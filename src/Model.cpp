@@ -1,62 +1,195 @@
 #include "Model/Model.h"
+#include "Model/PlanCache.h"
+#include "Model/InnovationRegistry.h"
 #include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Incoming connections of every node, grouped by target index in innovation order
+struct InEdges {
+    std::vector<int> start;   // per node index, plus one
+    std::vector<int> conn;    // connection index
+    std::vector<int> from;    // source node index
+};
+
+InEdges incoming(const NodeGenes &nodes, const ConnectionGenes &connections) {
+    const int connCount = static_cast<int>(connections.size());
+    InEdges in{std::vector<int>(nodes.size() + 1, 0), std::vector<int>(connCount), std::vector<int>(connCount)};
+    std::vector<int> target(connCount);
+    for (int c = 0; c < connCount; ++c) {
+        target[c] = nodes.find(connections.to[c]);
+        in.start[target[c] + 1]++;
+    }
+    for (size_t n = 0; n < nodes.size(); ++n) in.start[n + 1] += in.start[n];
+    std::vector<int> fill(in.start.begin(), in.start.end() - 1);
+    for (int c = 0; c < connCount; ++c) {
+        int i = fill[target[c]]++;
+        in.conn[i] = c;
+        in.from[i] = nodes.find(connections.from[c]);
+    }
+    return in;
+}
 
-Model::Model(int inputs, int outputs)
-        : inputs_(inputs), outputs_(outputs) {
+// Connections per node index both ways, as node indices
+struct Adjacency {
+    std::vector<int> outStart, outTo;   // per node index plus one; target node index
+    std::vector<int> inStart, inFrom;   // per node index plus one; source node index
+};
+
+Adjacency adjacency(const NodeGenes &nodes, const ConnectionGenes &connections) {
+    const int connCount = static_cast<int>(connections.size());
+    const size_t nodeCount = nodes.size();
+    Adjacency adj{std::vector<int>(nodeCount + 1, 0), std::vector<int>(connCount),
+                  std::vector<int>(nodeCount + 1, 0), std::vector<int>(connCount)};
+    // Ids are sorted; when their range is within a few times the genome, a table maps them
+    // without searching
+    const int firstId = nodeCount ? nodes.id[0] : 0;
+    const size_t span = nodeCount ? nodes.id[nodeCount - 1] - firstId + 1 : 0;
+    std::vector<int> index;
+    if (span <= 4 * (nodeCount + connCount)) {
+        index.resize(span);
+        for (size_t n = 0; n < nodeCount; ++n) index[nodes.id[n] - firstId] = static_cast<int>(n);
+    }
+    auto find = [&](int id) { return index.empty() ? nodes.find(id) : index[id - firstId]; };
+    std::vector<int> source(connCount), target(connCount);
+    for (int c = 0; c < connCount; ++c) {
+        source[c] = find(connections.from[c]);
+        target[c] = find(connections.to[c]);
+        adj.outStart[source[c] + 1]++;
+        adj.inStart[target[c] + 1]++;
+    }
+    for (size_t n = 0; n < nodeCount; ++n) {
+        adj.outStart[n + 1] += adj.outStart[n];
+        adj.inStart[n + 1] += adj.inStart[n];
+    }
+    std::vector<int> outFill(adj.outStart.begin(), adj.outStart.end() - 1);
+    std::vector<int> inFill(adj.inStart.begin(), adj.inStart.end() - 1);
+    for (int c = 0; c < connCount; ++c) {
+        adj.outTo[outFill[source[c]]++] = target[c];
+        adj.inFrom[inFill[target[c]]++] = source[c];
+    }
+    return adj;
+}
 
-    // Helper
-    auto createNode = [&](bool isInput, bool isHidden, ActivationType activationType) -> Node* {
-        auto node = std::make_unique<Node>(id_++, isHidden, isInput, activationType);
-        Node* nodePtr = node.get();
-        nodes_.emplace(node->getId(), std::move(node));
-        return nodePtr;
-    };
+}
 
-    // === Create Layers ===
-    std::vector<std::vector<Node*>> layers;
+template<typename T>
+void insertAt(CowVector<T> &values, size_t index, T value) {
+    std::vector<T> &v = values.write();
+    v.insert(v.begin() + index, value);
+}
+
+template<typename T>
+void eraseAt(CowVector<T> &values, size_t index) {
+    std::vector<T> &v = values.write();
+    v.erase(v.begin() + index);
+}
+
+int NodeGenes::find(int nodeId) const {
+    auto it = std::lower_bound(id.begin(), id.end(), nodeId);
+    return it != id.end() && *it == nodeId ? static_cast<int>(it - id.begin()) : -1;
+}
+
+void NodeGenes::insert(int nodeId, NodeKind nodeKind, ActivationType nodeActivation, double nodeBias, int nodeRank) {
+    size_t at = std::lower_bound(id.begin(), id.end(), nodeId) - id.begin();
+    insertAt(id, at, nodeId);
+    insertAt(kind, at, nodeKind);
+    insertAt(activation, at, nodeActivation);
+    insertAt(bias, at, nodeBias);
+    insertAt(rank, at, nodeRank);
+}
+
+void NodeGenes::erase(size_t index) {
+    eraseAt(id, index);
+    eraseAt(kind, index);
+    eraseAt(activation, index);
+    eraseAt(bias, index);
+    eraseAt(rank, index);
+}
+
+int ConnectionGenes::find(int connInnovation) const {
+    auto it = std::lower_bound(innovation.begin(), innovation.end(), connInnovation);
+    return it != innovation.end() && *it == connInnovation ? static_cast<int>(it - innovation.begin()) : -1;
+}
+
+void ConnectionGenes::insert(int connInnovation, int fromId, int toId, double connWeight, bool connEnabled) {
+    size_t at = std::lower_bound(innovation.begin(), innovation.end(), connInnovation) - innovation.begin();
+    insertAt(innovation, at, connInnovation);
+    insertAt(from, at, fromId);
+    insertAt(to, at, toId);
+    insertAt(weight, at, connWeight);
+    insertAt(enabled, at, static_cast<uint8_t>(false));
+
+    std::vector<int> &indices = active.write();
+    for (int &index : indices) index += index >= static_cast<int>(at);
+    insertAt(activeAt, at, -1);
+    setEnabled(at, connEnabled);
+}
+
+void ConnectionGenes::erase(size_t index) {
+    setEnabled(index, false);
+    eraseAt(innovation, index);
+    eraseAt(from, index);
+    eraseAt(to, index);
+    eraseAt(weight, index);
+    eraseAt(enabled, index);
+
+    eraseAt(activeAt, index);
+    std::vector<int> &indices = active.write();
+    for (int &i : indices) i -= i > static_cast<int>(index);
+}
+
+void ConnectionGenes::setEnabled(size_t index, bool connEnabled) {
+    if (enabled[index] == connEnabled)
+        return;
+    enabled.write()[index] = connEnabled;
+    std::vector<int> &indices = active.write(), &at = activeAt.write();
+    if (connEnabled) {
+        at[index] = static_cast<int>(indices.size());
+        indices.push_back(static_cast<int>(index));
+        return;
+    }
+    // Swap with the last entry
+    indices[at[index]] = indices.back();
+    at[indices.back()] = at[index];
+    indices.pop_back();
+    at[index] = -1;
+}
+
+void ConnectionGenes::indexEnabled() {
+    std::vector<int> indices, at(size(), -1);
+    for (size_t c = 0; c < size(); ++c) {
+        if (!enabled[c]) continue;
+        at[c] = static_cast<int>(indices.size());
+        indices.push_back(static_cast<int>(c));
+    }
+    active = CowVector<int>(std::move(indices));
+    activeAt = CowVector<int>(std::move(at));
+}
+
+Model::Model(int inputs, int outputs, const CounterRng &rng)
+        : inputs_(inputs), outputs_(outputs), rng_(rng) {
+    InnovationRegistry::global().reserveNodes(inputs + outputs);
 
-    // Input layer
-    std::vector<Node*> inputLayer;
     for (int i = 0; i < inputs; ++i)
-        inputLayer.push_back(createNode(true, false, ActivationType::Identity));
-    layers.push_back(inputLayer);
-    inputNodes_ = inputLayer;
-
-    // Hidden Layer 1: 24 neurons
-//    std::vector<Node*> hidden1;
-//    for (int i = 0; i < 24; ++i)
-//        hidden1.push_back(createNode(false, true, ActivationType::Tanh));
-//    layers.push_back(hidden1);
-
-    // Hidden Layer 2: 32 neurons
-//    std::vector<Node*> hidden2;
-//    for (int i = 0; i < 16; ++i)
-//        hidden2.push_back(createNode(false, true, ActivationType::Tanh));
-//    layers.push_back(hidden2);
-
-//    // Hidden layer 3: 16 neurons
-//    std::vector<Node*> hidden3;
-//    for (int i = 0; i < 16; ++i)
-//        hidden3.push_back(createNode(false, true, ActivationType::ReLU));
-//    layers.push_back(hidden3);
-
-    // Output layer
-    std::vector<Node*> outputLayer;
+        nodes_.insert(i, NodeKind::Input, ActivationType::Identity, 0.0, i);
     for (int i = 0; i < outputs; ++i)
-        outputLayer.push_back(createNode(false, false, ActivationType::Identity));
-    layers.push_back(outputLayer);
-    outputNodes_ = outputLayer;
-
-    // === Connect Fully Between Layers ===
-    for (size_t i = 0; i + 1 < layers.size(); ++i) {
-        for (Node* from : layers[i]) {
-            for (Node* to : layers[i + 1]) {
-                addConnection(from, to);
-            }
+        nodes_.insert(inputs + i, NodeKind::Output, ActivationType::Identity, newValue(mutationConfig_, rng_),
+                      inputs + i);
+
+    // Connect every input to every output
+    for (int from = 0; from < inputs; ++from) {
+        for (int to = inputs; to < inputs + outputs; ++to) {
+            addConnection(from, to, newValue(mutationConfig_, rng_));
         }
     }
 }
 
+Model::Model(int inputs, int outputs, Empty)
+        : inputs_(inputs), outputs_(outputs) {}
+
 
 //Model::Model(int inputs, int outputs) : inputs_(inputs), outputs_(outputs) {
 //    for (int i = 0; i < inputs; ++i) {
@@ -126,203 +259,471 @@ Model::Model(int inputs, int outputs)
 //    }
 //}
 
-void Model::addConnection(Node *from, Node *to) {
-    auto conn = std::make_unique<Connection>(from->getId(), to->getId());
-    connections_.emplace(std::make_pair(from->getId(), to->getId()), std::move(conn));
-    from->addOut(to->getId());
-    to->addIn(from->getId());
+void Model::addConnection(int from, int to, double weight) {
+    int innovation = InnovationRegistry::global().connection(from, to);
+    connections_.insert(innovation, from, to, weight, true);
 }
 
-void Model::addConnection(double weight, Node *from, Node *to) {
-    auto conn = std::make_unique<Connection>(weight, from->getId(), to->getId());
-    connections_.emplace(std::make_pair(from->getId(), to->getId()), std::move(conn));
-    from->addOut(to->getId());
-    to->addIn(from->getId());
+void Model::removeNode(size_t index) {
+    int id = nodes_.id[index];
+    for (size_t c = connections_.size(); c-- > 0;) {
+        if (connections_.from[c] == id || connections_.to[c] == id) connections_.erase(c);
+    }
+    nodes_.erase(index);
 }
 
-void Model::removeConnection(Connection *conn) {
-    nodes_.at(conn->getFrom())->removeOut(conn->getTo());
-    nodes_.at(conn->getTo())->removeIn(conn->getFrom());
-    connections_.erase({conn->getFrom(), conn->getTo()});
+bool Model::orderBefore(int from, int to) {
+    const CowVector<int> &rank = nodes_.rank;
+    if (rank[from] < rank[to])
+        return true;
+    if (from == to)
+        return false;
+
+    // Only nodes ranked between the two can be out of order once from -> to exists:
+    // those to reaches, which must move after from (reaching from itself is a cycle),
+    // and those reaching from, which must move before to
+    const int lower = rank[to], upper = rank[from];
+    // One pass builds the adjacency; each search then only reads the edges of the nodes it reaches
+    const Adjacency adj = adjacency(nodes_, connections_);
+    std::vector<uint8_t> seen(nodes_.size(), 0);
+    std::vector<int> forward{to}, backward{from};
+    seen[to] = seen[from] = 1;
+    for (size_t i = 0; i < forward.size(); ++i) {
+        for (int e = adj.outStart[forward[i]]; e < adj.outStart[forward[i] + 1]; ++e) {
+            int next = adj.outTo[e];
+            if (next == from) return false;
+            if (!seen[next] && rank[next] < upper) {
+                seen[next] = 1;
+                forward.push_back(next);
+            }
+        }
+    }
+    for (size_t i = 0; i < backward.size(); ++i) {
+        for (int e = adj.inStart[backward[i]]; e < adj.inStart[backward[i] + 1]; ++e) {
+            int next = adj.inFrom[e];
+            if (!seen[next] && rank[next] > lower) {
+                seen[next] = 1;
+                backward.push_back(next);
+            }
+        }
+    }
+
+    // Both groups keep their inner order and reuse the same ranks, backward ones first
+    auto byRank = [&rank](int a, int b) { return rank[a] < rank[b]; };
+    std::sort(forward.begin(), forward.end(), byRank);
+    std::sort(backward.begin(), backward.end(), byRank);
+    std::vector<int> ranks;
+    for (int n : backward) ranks.push_back(rank[n]);
+    for (int n : forward) ranks.push_back(rank[n]);
+    std::sort(ranks.begin(), ranks.end());
+    std::vector<int> &reordered = nodes_.rank.write();
+    size_t next = 0;
+    for (int n : backward) reordered[n] = ranks[next++];
+    for (int n : forward) reordered[n] = ranks[next++];
+    return true;
+}
+
+void Model::rebuildOrder() {
+    // Depth-first post-order over incoming connections, outputs first. A connection whose
+    // source is still on the stack closes a cycle; evaluation never read it, so it goes.
+    const int nodeCount = static_cast<int>(nodes_.size());
+    const InEdges in = incoming(nodes_, connections_);
+    std::vector<uint8_t> visited(nodeCount, 0), done(nodeCount, 0), drop(connections_.size(), 0);
+    std::vector<int> &rank = nodes_.rank.write();
+    int nextRank = 0;
+
+    struct Frame {
+        int node;
+        int next;
+    };
+    std::vector<Frame> stack;
+    auto visit = [&](int root) {
+        if (visited[root])
+            return;
+        visited[root] = 1;
+        stack.push_back({root, in.start[root]});
+        while (!stack.empty()) {
+            Frame &frame = stack.back();
+            if (frame.next < in.start[frame.node + 1]) {
+                int source = in.from[frame.next++];
+                if (!visited[source]) {
+                    visited[source] = 1;
+                    stack.push_back({source, in.start[source]});
+                }
+                continue;
+            }
+
+            int node = frame.node;
+            for (int i = in.start[node]; i < in.start[node + 1]; ++i) {
+                if (!done[in.from[i]]) drop[in.conn[i]] = 1;
+            }
+            rank[node] = nextRank++;
+            done[node] = 1;
+            stack.pop_back();
+        }
+    };
+    for (int output = inputs_; output < inputs_ + outputs_; ++output) visit(output);
+    for (int n = 0; n < nodeCount; ++n) visit(n);
+
+    for (size_t c = connections_.size(); c-- > 0;) {
+        if (drop[c]) connections_.erase(c);
+    }
 }
 
 void Model::addConnectionMutation() {
-    Node *n1 = getRandomPair(nodes_).second.get();
-    Node *n2 = getRandomPair(nodes_).second.get();
+    std::uniform_int_distribution<int> pick(0, static_cast<int>(nodes_.size()) - 1);
+    int fromIndex = pick(rng_), toIndex = pick(rng_);
+    int from = nodes_.id[fromIndex], to = nodes_.id[toIndex];
 
-    if (connections_.find({n1->getId(), n2->getId()}) != connections_.end()) {
-        connections_.at({n1->getId(), n2->getId()})->setEnabled(true);
+    int existing = connections_.find(InnovationRegistry::global().find(from, to));
+    if (existing >= 0) {
+        connections_.setEnabled(existing, true);
         return;
     }
 
-    if (checkCycle(&nodes_, n1->getId(), n2->getId()))
+    // Usually settled by comparing two ranks
+    if (!orderBefore(fromIndex, toIndex))
         return;
 
-    addConnection(n1, n2);
+    addConnection(from, to, newValue(mutationConfig_, rng_));
 }
 
 void Model::removeConnectionMutation() {
-    Connection *conn = getRandomPair(connections_).second.get();
-    removeConnection(conn);
+    if (connections_.size() == 0)
+        return;
+    std::uniform_int_distribution<size_t> pick(0, connections_.size() - 1);
+    connections_.erase(pick(rng_));
 }
 
 void Model::addNodeMutation() {
-    Connection *conn = getRandomPair(connections_).second.get();
-    double oldWeight = conn->getWeight();
-
-    auto node = std::make_unique<Node>(id_++, true, false, ActivationType::Tanh);
-    int nodeId = node->getId();
-    nodes_.emplace(nodeId, std::move(node));
+    if (connections_.active.empty())
+        return;
+    std::uniform_int_distribution<size_t> pick(0, connections_.active.size() - 1);
+    size_t split = connections_.active[pick(rng_)];
+    int from = connections_.from[split], to = connections_.to[split];
+    double oldWeight = connections_.weight[split];
+    connections_.setEnabled(split, false);
+
+    // Genomes splitting the same connection agree on the new node, unless this one
+    // already holds it from an earlier split
+    InnovationRegistry &registry = InnovationRegistry::global();
+    int id = registry.splitNode(from, to);
+    if (nodes_.find(id) >= 0)
+        id = registry.newNode();
+    // Ranked last, after from; only what to reaches has to move to fit it before to
+    int rank = *std::max_element(nodes_.rank.begin(), nodes_.rank.end()) + 1;
+    nodes_.insert(id, NodeKind::Hidden, ActivationType::Tanh, newValue(mutationConfig_, rng_), rank);
+    orderBefore(nodes_.find(id), nodes_.find(to));
+
+    addConnection(from, id, 1.0);
+    addConnection(id, to, oldWeight);
+}
 
-    addConnection(1.0, nodes_.at(conn->getFrom()).get(), nodes_.at(nodeId).get());
-    addConnection(oldWeight, nodes_.at(nodeId).get(), nodes_.at(conn->getTo()).get());
+void Model::removeNodeMutation() {
+    // Every node is equally likely to be drawn, but only hidden ones go
+    std::uniform_int_distribution<size_t> pick(0, nodes_.size() - 1);
+    size_t index = pick(rng_);
+    if (index < static_cast<size_t>(inputs_ + outputs_))
+        return;
 
-    conn->setEnabled(false);
+    removeNode(index);
 }
 
-void Model::removeNodeMutation() {
-    Node *node = getRandomPair(nodes_).second.get();
-    if (!node->isHidden())
+void Model::compile() {
+    // Folded constants depend on the activation mode, so a mode switch recompiles
+    const ActivationMode mode = getActivationMode();
+    if (compiled_ && phenotype_.getConstantMode() == mode)
         return;
 
-    for (int outId: node->getOut()) {
-        removeConnection(connections_.at({node->getId(), outId}).get());
-    }
+    // Identical structures share one plan; only the parameters are gathered per genome
+    std::vector<int> key = structureKey();
+    size_t hash = 0;
+    for (int v : key) hash ^= std::hash<int>()(v) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
 
-    for (int inId: node->getIn()) {
-        removeConnection(connections_.at({inId, node->getId()}).get());
+    PlanCache &cache = PlanCache::global();
+    std::shared_ptr<const PhenotypePlan> plan = cache.find(hash, key);
+    if (!plan) {
+        plan = buildPlan();
+        cache.insert(hash, std::move(key), plan);
     }
 
-    nodes_.erase(node->getId());
-}
-
-bool Model::checkCycle(std::unordered_map<int, std::unique_ptr<Node> > *nodes, int from, int to) {
-    std::unordered_set<int> visited;
-    std::function<bool(int)> dfs = [&](int current) -> bool {
-        if (current == from) return true;
-        if (!visited.insert(current).second) return false;
+    phenotype_ = Phenotype(plan);
+    Phenotype &p = phenotype_;
+    const double *weight = connections_.weight.data();
+
+    // Constants are evaluated here exactly as a full evaluation would, and so are the
+    // starting sums of rows that lead with constant sources.
+    p.values_.assign(p.getNodeCount(), 0.0);
+    p.constantMode_ = mode;
+    for (int c = 0; c < plan->constants; ++c) {
+        int node = plan->constNode[c];
+        double sum = 0.0;
+        for (int e = plan->constStart[c]; e < plan->constStart[c + 1]; ++e) {
+            sum += p.values_[plan->constSource[e]] * weight[plan->constGene[e]];
+        }
+        p.values_[plan->inputs + c] = applyActivation(nodes_.activation[node], sum + nodes_.bias[node], mode);
+    }
 
-        for (int neighborId: nodes->at(current)->getOut()) {
-            if (dfs(neighborId)) return true;
+    const int computed = static_cast<int>(plan->rowNode.size());
+    p.seed_.resize(computed);
+    p.bias_.resize(computed);
+    for (int n = 0; n < computed; ++n) {
+        double sum = 0.0;
+        for (int e = plan->seedStart[n]; e < plan->seedStart[n + 1]; ++e) {
+            sum += p.values_[plan->seedSource[e]] * weight[plan->seedGene[e]];
         }
-        return false;
-    };
-    return dfs(to);
-}
+        p.seed_[n] = sum;
+        p.bias_[n] = nodes_.bias[plan->rowNode[n]];
+    }
+    p.inWeight_.resize(plan->edgeGene.size());
+    for (size_t e = 0; e < plan->edgeGene.size(); ++e) {
+        p.inWeight_[e] = weight[plan->edgeGene[e]];
+    }
 
-std::vector<double> Model::feedForward(std::vector<double> &inputs) {
-    if (inputs.size() != inputNodes_.size())
-        throw std::invalid_argument("Input size mismatch");
+    p.stats_.genomeNodes = static_cast<int>(nodes_.size());
+    p.stats_.genomeEdges = static_cast<int>(connections_.size());
+    p.stats_.nodes = plan->inputs + computed;
+    p.stats_.edges = p.getEdgeCount();
+    p.stats_.folded = plan->constants;
+    p.setPrecision(precision_);
+    compiled_ = true;
+    ++revision_;
+}
 
-    // Clear all node values before a new evaluation
-    for (auto& [_, node] : nodes_) {
-        node->setValue(0.0);
+std::vector<int> Model::structureKey() const {
+    // Everything buildPlan() reads. Both gene arrays are sorted, so equal keys also mean
+    // equal gene indices.
+    std::vector<int> key;
+    key.reserve(4 + 3 * (nodes_.size() + connections_.size()));
+    key.push_back(inputs_);
+    key.push_back(outputs_);
+    key.push_back(static_cast<int>(nodes_.size()));
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        key.push_back(nodes_.id[i]);
+        key.push_back(static_cast<int>(nodes_.kind[i]));
+        key.push_back(static_cast<int>(nodes_.activation[i]));
     }
-
-    // Set input node values
-    for (size_t i = 0; i < inputs.size(); ++i) {
-        inputNodes_[i]->setValue(inputs[i]);
+    key.push_back(static_cast<int>(connections_.size()));
+    for (size_t c = 0; c < connections_.size(); ++c) {
+        key.push_back(connections_.from[c]);
+        key.push_back(connections_.to[c]);
+        key.push_back(connections_.enabled[c]);
     }
+    return key;
+}
 
-    std::vector<double> outputs(outputNodes_.size());
-    std::unordered_set<int> visited;
+std::shared_ptr<PhenotypePlan> Model::buildPlan() const {
+    auto plan = std::make_shared<PhenotypePlan>();
+    plan->inputs = inputs_;
+    const int nodeCount = static_cast<int>(nodes_.size());
+    const InEdges in = incoming(nodes_, connections_);
+
+    // Nodes the outputs read through enabled connections. Inputs are set, not computed,
+    // so their own sources are never read.
+    std::vector<uint8_t> needed(nodeCount, 0);
+    std::vector<int> stack;
+    for (int output = inputs_; output < inputs_ + outputs_; ++output) stack.push_back(output);
+    while (!stack.empty()) {
+        int node = stack.back();
+        stack.pop_back();
+        if (needed[node])
+            continue;
+        needed[node] = 1;
+        if (nodes_.kind[node] == NodeKind::Input)
+            continue;
+        for (int i = in.start[node]; i < in.start[node + 1]; ++i) {
+            if (connections_.enabled[in.conn[i]]) stack.push_back(in.from[i]);
+        }
+    }
 
-    std::function<void(Node *)> visit = [&](Node *node) {
-        if (!visited.insert(node->getId()).second)
-            return;
+    std::vector<int> rows;
+    for (int n = 0; n < nodeCount; ++n) {
+        if (needed[n] && nodes_.kind[n] != NodeKind::Input) rows.push_back(n);
+    }
+    std::sort(rows.begin(), rows.end(), [this](int a, int b) { return nodes_.rank[a] < nodes_.rank[b]; });
 
-        for (int inId : node->getIn()) {
-            visit(nodes_.at(inId).get());
+    // A needed node with the enabled connections it reads, in the topological order
+    struct Entry {
+        int node;
+        std::vector<int> in;
+        bool constant;
+    };
+    std::vector<Entry> order;
+    std::vector<uint8_t> constant(nodeCount, 0);
+    for (int node : rows) {
+        // A node that reads no input, directly or through other nodes, is a constant
+        Entry entry{node, {}, true};
+        for (int i = in.start[node]; i < in.start[node + 1]; ++i) {
+            if (!connections_.enabled[in.conn[i]])
+                continue;
+            entry.in.push_back(in.conn[i]);
+            entry.constant &= constant[in.from[i]] != 0;
         }
+        constant[node] = entry.constant;
+        order.push_back(std::move(entry));
+    }
+    std::vector<int> fromIndex(connections_.size());
+    for (int i = 0; i < static_cast<int>(in.conn.size()); ++i) fromIndex[in.conn[i]] = in.from[i];
+
+    // Slots: inputs, constants, computed nodes, each group in evaluation order
+    std::vector<int> slot(nodeCount, -1);
+    for (int i = 0; i < inputs_; ++i) slot[i] = i;
+    for (const auto &entry : order) {
+        if (entry.constant) slot[entry.node] = plan->inputs + plan->constants++;
+    }
+    int computedSlot = plan->inputs + plan->constants;
+    for (const auto &entry : order) {
+        if (!entry.constant) slot[entry.node] = computedSlot++;
+    }
 
-        if (!node->isInput()) {
-            double sum = 0.0;
-            for (int inId : node->getIn()) {
-                Node *inNode = nodes_.at(inId).get();
-                auto connIt = connections_.find({inId, node->getId()});
-                if (connIt != connections_.end() && connIt->second->isEnabled()) {
-                    double weight = connIt->second->getWeight();
-                    sum += inNode->getValue() * weight;
-                }
+    // A row's leading run of constant sources folds into its starting sum. Constant
+    // sources further along the row stay as edges so every sum keeps its original order.
+    auto sourceSlot = [&](int c) { return slot[fromIndex[c]]; };
+    auto isConstantSlot = [&plan](int s) { return s >= plan->inputs && s < plan->computedBase(); };
+    for (const auto &entry : order) {
+        size_t e = 0;
+        if (entry.constant) {
+            plan->constNode.push_back(entry.node);
+            for (; e < entry.in.size(); ++e) {
+                plan->constSource.push_back(sourceSlot(entry.in[e]));
+                plan->constGene.push_back(entry.in[e]);
             }
-            node->setValue(node->activate(sum + node->getBias()));
+            plan->constStart.push_back(static_cast<int>(plan->constSource.size()));
+            continue;
         }
-    };
+        for (; e < entry.in.size() && isConstantSlot(sourceSlot(entry.in[e])); ++e) {
+            plan->seedSource.push_back(sourceSlot(entry.in[e]));
+            plan->seedGene.push_back(entry.in[e]);
+        }
+        plan->seedStart.push_back(static_cast<int>(plan->seedSource.size()));
+        for (; e < entry.in.size(); ++e) {
+            plan->inSource.push_back(sourceSlot(entry.in[e]));
+            plan->edgeGene.push_back(entry.in[e]);
+        }
+        plan->inStart.push_back(static_cast<int>(plan->inSource.size()));
+        plan->rowNode.push_back(entry.node);
+        plan->activation.push_back(nodes_.activation[entry.node]);
+    }
 
-    // Start traversal from each output node
-    for (auto *node : outputNodes_) {
-        visit(node);
+    for (int output = inputs_; output < inputs_ + outputs_; ++output) {
+        plan->outputIndex.push_back(slot[output]);
     }
+    plan->hashTopology();
+    plan->indexConsumers();
+    return plan;
+}
 
-    // Collect final output values
-    for (size_t i = 0; i < outputNodes_.size(); ++i) {
-        outputs[i] = outputNodes_[i]->getValue();
+void Model::compile(Precision precision) {
+    if (precision != precision_) {
+        precision_ = precision;
+        compiled_ = false;
     }
+    compile();
+}
 
+std::vector<double> Model::feedForward(std::vector<double> &inputs) {
+    std::vector<double> outputs(outputs_);
+    activate(inputs.data(), inputs.size(), outputs.data(), outputs.size());
     return outputs;
 }
 
+void Model::activate(const double *inputs, size_t inputCount, double *outputs, size_t outputCount) {
+    if (inputCount != static_cast<size_t>(inputs_))
+        throw std::invalid_argument("Input size mismatch");
+    if (outputCount != static_cast<size_t>(outputs_))
+        throw std::invalid_argument("Output size mismatch");
+    getPhenotype().activate(inputs, outputs);
+}
 
-std::unique_ptr<Model> Model::crossover(Model *other) {
-    Model *fitter = other->fitness_ > this->fitness_ ? other : this;
-    Model *lessFitter = other->fitness_ <= this->fitness_ ? other : this;
-    auto child = std::make_unique<Model>(inputs_, outputs_);
+void Model::activateBatch(const double *inputs, size_t rows, double *outputs) {
+    getPhenotype().activateBatch(inputs, rows, outputs);
+}
 
-    for (auto &it: fitter->nodes_) {
-        auto &currNode = it.second;
-        auto otherNodeIt = lessFitter->nodes_.find(it.first);
-        if (otherNodeIt != lessFitter->nodes_.end())
-            child->nodes_.emplace(it.first, currNode->crossover(otherNodeIt->second.get()));
-        else
-            child->nodes_.emplace(it.first, std::make_unique<Node>(*currNode));
+void Model::decideBatch(const double *inputs, size_t rows, int *actions) {
+    std::vector<double> outputs(rows * outputs_);
+    activateBatch(inputs, rows, outputs.data());
+    for (size_t r = 0; r < rows; ++r) {
+        const double *row = outputs.data() + r * outputs_;
+        actions[r] = static_cast<int>(std::max_element(row, row + outputs_) - row);
     }
+}
 
-    for (auto &it: fitter->connections_) {
-        auto &currConnection = it.second;
-        auto otherConnectionIt = lessFitter->connections_.find(it.first);
-        if (otherConnectionIt != lessFitter->connections_.end())
-            child->connections_.emplace(it.first, currConnection->crossover(otherConnectionIt->second.get()));
-        else
-            child->connections_.emplace(it.first, std::make_unique<Connection>(*currConnection));
+
+std::unique_ptr<Model> Model::crossover(Model *other, const CounterRng &rng) {
+    Model *fitter = other->fitness_ > this->fitness_ ? other : this;
+    Model *lessFitter = other->fitness_ <= this->fitness_ ? other : this;
+    auto child = std::unique_ptr<Model>(new Model(inputs_, outputs_, Empty{}));
+    child->rng_ = rng;
+    CounterRng &pick = child->rng_;
+
+    // Genes line up by number: matching ones mix both parents, the rest come from the fitter.
+    // The child has exactly the fitter's genes, so it shares the fitter's structure arrays
+    // (ranks included, they still hold) and gets fresh ones only for the mixed values.
+    const NodeGenes &a = fitter->nodes_, &b = lessFitter->nodes_;
+    NodeGenes &nodes = child->nodes_;
+    nodes.id = a.id;
+    nodes.kind = a.kind;
+    nodes.rank = a.rank;
+    std::vector<double> bias(a.size());
+    std::vector<ActivationType> activation(a.size());
+    for (size_t i = 0, j = 0; i < a.size(); ++i) {
+        while (j < b.size() && b.id[j] < a.id[i]) ++j;
+        bool matching = j < b.size() && b.id[j] == a.id[i];
+        bias[i] = matching ? pickRandom(a.bias[i], b.bias[j], pick) : a.bias[i];
+        activation[i] = matching ? pickRandom(a.activation[i], b.activation[j], pick) : a.activation[i];
+    }
+    nodes.bias = CowVector<double>(std::move(bias));
+    // Activations rarely differ between parents
+    nodes.activation = std::equal(activation.begin(), activation.end(), a.activation.begin())
+                       ? a.activation : CowVector<ActivationType>(std::move(activation));
+
+    const ConnectionGenes &x = fitter->connections_, &y = lessFitter->connections_;
+    ConnectionGenes &connections = child->connections_;
+    connections.innovation = x.innovation;
+    connections.from = x.from;
+    connections.to = x.to;
+    std::vector<double> weight(x.size());
+    std::vector<uint8_t> enabled(x.size());
+    for (size_t i = 0, j = 0; i < x.size(); ++i) {
+        while (j < y.size() && y.innovation[j] < x.innovation[i]) ++j;
+        bool matching = j < y.size() && y.innovation[j] == x.innovation[i];
+        weight[i] = matching ? pickRandom(x.weight[i], y.weight[j], pick) : x.weight[i];
+        enabled[i] = matching ? pickRandom(x.enabled[i], y.enabled[j], pick) : x.enabled[i];
     }
+    connections.weight = CowVector<double>(std::move(weight));
+    connections.enabled = CowVector<uint8_t>(std::move(enabled));
+    connections.indexEnabled();
 
     return child;
 }
 
 void Model::mutate() {
+    compiled_ = false;
     std::uniform_real_distribution<double> dist(0.0, 1.0);
 
-    for (auto &[id, node] : nodes_) {
-        if (!node->isHidden()) continue;
-
-        if (dist(rng_) < mutationConfig_.mutation_rate) {
-            if (dist(rng_) < mutationConfig_.replace_rate) {
-                node->setBias(newValue());
-            } else {
-                node->setBias(mutationDelta(node->getBias()));
-            }
-        }
+    // Writing copies these arrays if a clone or crossover child still shares them
+    const size_t firstHidden = inputs_ + outputs_;
+    if (nodes_.size() > firstHidden) {
+        std::vector<double> &bias = nodes_.bias.write();
+        size_t hidden = bias.size() - firstHidden;
+        mutateArray(mutationConfig_, rng_, rng_.take(3 * hidden), bias.data() + firstHidden, nullptr, hidden);
+    }
+    if (!connections_.active.empty()) {
+        std::vector<double> &weight = connections_.weight.write();
+        mutateArray(mutationConfig_, rng_, rng_.take(3 * weight.size()), weight.data(), connections_.enabled.data(),
+                    weight.size());
+    }
 
+//    for (size_t i = firstHidden; i < nodes_.size(); ++i) {
 //        if (dist(rng_) < 0.01) {
-//            node->setActivation(Node::getRandomActivation());
+//            nodes_.activation.write()[i] = static_cast<ActivationType>(dist(rng_) * 4);
 //        }
-    }
-
-    for (auto &[key, conn] : connections_) {
-        if (!conn->isEnabled()) continue;
-
-        if (dist(rng_) < mutationConfig_.mutation_rate) {
-            if (dist(rng_) < mutationConfig_.replace_rate) {
-                conn->setWeight(newValue());
-            } else {
-                conn->setWeight(mutationDelta(conn->getWeight()));
-            }
-        }
-
+//    }
+//    for (size_t c = 0; c < connections_.size(); ++c) {
 //        if (dist(rng_) < 0.01) {
-//            conn->setEnabled(!conn->isEnabled());
+//            connections_.setEnabled(c, !connections_.enabled[c]);
 //        }
-    }
+//    }
 
 
 //    if (dist(rng_) < 0.1) { addConnectionMutation(); }   // more links early on
@@ -338,86 +739,138 @@ void Model::mutate() {
 }
 
 void Model::save(std::ostream& out) const {
+    // Same layout the node and connection objects used to write, in/out sets included
+    int nextId = nodes_.size() == 0 ? 0 : nodes_.id.back() + 1;
     out.write(reinterpret_cast<const char*>(&inputs_), sizeof(inputs_));
     out.write(reinterpret_cast<const char*>(&outputs_), sizeof(outputs_));
-    out.write(reinterpret_cast<const char*>(&id_), sizeof(id_));
+    out.write(reinterpret_cast<const char*>(&nextId), sizeof(nextId));
     out.write(reinterpret_cast<const char*>(&fitness_), sizeof(fitness_));
 
     size_t nodeCount = nodes_.size();
     out.write(reinterpret_cast<const char*>(&nodeCount), sizeof(nodeCount));
-    for (const auto& [id, node] : nodes_) {
+    for (size_t i = 0; i < nodeCount; ++i) {
+        int id = nodes_.id[i];
+        bool hidden = nodes_.kind[i] == NodeKind::Hidden, input = nodes_.kind[i] == NodeKind::Input;
+        auto act = static_cast<int>(nodes_.activation[i]);
+        out.write(reinterpret_cast<const char*>(&id), sizeof(id));
         out.write(reinterpret_cast<const char*>(&id), sizeof(id));
-        node->save(out);
+        out.write(reinterpret_cast<const char*>(&nodes_.bias[i]), sizeof(double));
+        out.write(reinterpret_cast<const char*>(&hidden), sizeof(hidden));
+        out.write(reinterpret_cast<const char*>(&input), sizeof(input));
+        out.write(reinterpret_cast<const char*>(&act), sizeof(act));
+
+        std::vector<int> in, outs;
+        for (size_t c = 0; c < connections_.size(); ++c) {
+            if (connections_.to[c] == id) in.push_back(connections_.from[c]);
+            if (connections_.from[c] == id) outs.push_back(connections_.to[c]);
+        }
+        size_t inSize = in.size(), outSize = outs.size();
+        out.write(reinterpret_cast<const char*>(&inSize), sizeof(inSize));
+        out.write(reinterpret_cast<const char*>(in.data()), inSize * sizeof(int));
+        out.write(reinterpret_cast<const char*>(&outSize), sizeof(outSize));
+        out.write(reinterpret_cast<const char*>(outs.data()), outSize * sizeof(int));
     }
 
     size_t connCount = connections_.size();
     out.write(reinterpret_cast<const char*>(&connCount), sizeof(connCount));
-    for (const auto& [key, conn] : connections_) {
-        out.write(reinterpret_cast<const char*>(&key.first), sizeof(int));
-        out.write(reinterpret_cast<const char*>(&key.second), sizeof(int));
-        conn->save(out);
+    for (size_t c = 0; c < connCount; ++c) {
+        bool enabled = connections_.enabled[c];
+        out.write(reinterpret_cast<const char*>(&connections_.from[c]), sizeof(int));
+        out.write(reinterpret_cast<const char*>(&connections_.to[c]), sizeof(int));
+        out.write(reinterpret_cast<const char*>(&connections_.weight[c]), sizeof(double));
+        out.write(reinterpret_cast<const char*>(&connections_.from[c]), sizeof(int));
+        out.write(reinterpret_cast<const char*>(&connections_.to[c]), sizeof(int));
+        out.write(reinterpret_cast<const char*>(&enabled), sizeof(enabled));
     }
 }
 
 void Model::load(std::istream& in) {
+    compiled_ = false;
+    int nextId;
     in.read(reinterpret_cast<char*>(&inputs_), sizeof(inputs_));
     in.read(reinterpret_cast<char*>(&outputs_), sizeof(outputs_));
-    in.read(reinterpret_cast<char*>(&id_), sizeof(id_));
+    in.read(reinterpret_cast<char*>(&nextId), sizeof(nextId));
     in.read(reinterpret_cast<char*>(&fitness_), sizeof(fitness_));
 
+    // Saved in/out sets only matter for connections a node no longer lists as an input:
+    // evaluation never reached those, so they are dropped
+    std::vector<std::pair<int, std::vector<int>>> inSets;
     size_t nodeCount;
     in.read(reinterpret_cast<char*>(&nodeCount), sizeof(nodeCount));
-    nodes_.clear();
-    inputNodes_.clear();
-    outputNodes_.clear();
+    nodes_ = NodeGenes{};
     for (size_t i = 0; i < nodeCount; ++i) {
-        int id;
+        int id, act;
+        double bias;
+        bool hidden, input;
+        in.read(reinterpret_cast<char*>(&id), sizeof(id));
         in.read(reinterpret_cast<char*>(&id), sizeof(id));
-        auto node = std::make_unique<Node>(0, false, false);
-        node->load(in);
-        if (node->isInput()) inputNodes_.push_back(node.get());
-        else if (!node->isHidden()) outputNodes_.push_back(node.get());
-        nodes_[id] = std::move(node);
+        in.read(reinterpret_cast<char*>(&bias), sizeof(bias));
+        in.read(reinterpret_cast<char*>(&hidden), sizeof(hidden));
+        in.read(reinterpret_cast<char*>(&input), sizeof(input));
+        in.read(reinterpret_cast<char*>(&act), sizeof(act));
+
+        std::vector<int> ids[2];
+        for (auto &set : ids) {
+            size_t size;
+            in.read(reinterpret_cast<char*>(&size), sizeof(size));
+            set.resize(size);
+            in.read(reinterpret_cast<char*>(set.data()), size * sizeof(int));
+        }
+        inSets.emplace_back(id, std::move(ids[0]));
+
+        // Older files may have lost the hidden flag in crossover; the id range is reliable
+        NodeKind kind = id < inputs_ ? NodeKind::Input : id < inputs_ + outputs_ ? NodeKind::Output : NodeKind::Hidden;
+        nodes_.insert(id, kind, static_cast<ActivationType>(act), bias, 0);
     }
 
     size_t connCount;
     in.read(reinterpret_cast<char*>(&connCount), sizeof(connCount));
-    connections_.clear();
+    connections_ = ConnectionGenes{};
+    InnovationRegistry &registry = InnovationRegistry::global();
     for (size_t i = 0; i < connCount; ++i) {
         int from, to;
+        double weight;
+        bool enabled;
         in.read(reinterpret_cast<char*>(&from), sizeof(from));
         in.read(reinterpret_cast<char*>(&to), sizeof(to));
-        auto conn = std::make_unique<Connection>(0.0, from, to);
-        conn->load(in);
-        connections_[{from, to}] = std::move(conn);
+        in.read(reinterpret_cast<char*>(&weight), sizeof(weight));
+        in.read(reinterpret_cast<char*>(&from), sizeof(from));
+        in.read(reinterpret_cast<char*>(&to), sizeof(to));
+        in.read(reinterpret_cast<char*>(&enabled), sizeof(enabled));
+
+        if (nodes_.find(from) < 0 || nodes_.find(to) < 0)
+            continue;
+        const auto &inSet = std::find_if(inSets.begin(), inSets.end(),
+                                         [to](const auto &set) { return set.first == to; })->second;
+        if (std::find(inSet.begin(), inSet.end(), from) == inSet.end())
+            continue;
+        connections_.insert(registry.connection(from, to), from, to, weight, enabled);
     }
+    registry.reserveNodes(std::max(nextId, nodes_.size() == 0 ? 0 : nodes_.id.back() + 1));
+    rebuildOrder();
 }
 
 double Model::getCompatibilityDistance(Model *other) {
-    const auto& conn1 = this->connections_;
-    const auto& conn2 = other->connections_;
-
-    std::unordered_set<std::pair<int, int>, PairHash> keys1, keys2;
-    for (const auto& [k, _] : conn1) keys1.insert(k);
-    for (const auto& [k, _] : conn2) keys2.insert(k);
+    // Both connection arrays are sorted by innovation, so one merge finds every match
+    const ConnectionGenes &conn1 = this->connections_;
+    const ConnectionGenes &conn2 = other->connections_;
 
     int matching = 0;
     double weightDiffSum = 0.0;
-
-    for (const auto& k : keys1) {
-        if (keys2.count(k)) {
+    size_t i = 0, j = 0;
+    while (i < conn1.size() && j < conn2.size()) {
+        if (conn1.innovation[i] < conn2.innovation[j]) {
+            ++i;
+        } else if (conn2.innovation[j] < conn1.innovation[i]) {
+            ++j;
+        } else {
             ++matching;
-            weightDiffSum += std::abs(conn1.at(k)->getWeight() - conn2.at(k)->getWeight());
+            weightDiffSum += std::abs(conn1.weight[i++] - conn2.weight[j++]);
         }
     }
 
-    int total = std::max(keys1.size(), keys2.size());
-    int disjoint = 0, excess = 0;
-
-    for (const auto& k : keys1)
-        if (!keys2.count(k)) ++disjoint;
-    for (const auto& k : keys2)
-        if (!keys1.count(k)) ++disjoint;
+    int total = static_cast<int>(std::max(conn1.size(), conn2.size()));
+    int disjoint = static_cast<int>(conn1.size() + conn2.size()) - 2 * matching;
 
     // Normalize
     if (total < 20) total = 1;
@@ -429,32 +882,15 @@ double Model::getCompatibilityDistance(Model *other) {
 }
 
 
-std::unique_ptr<Model> Model::clone() const {
-    auto cloned = std::make_unique<Model>(inputs_, outputs_);
-    cloned->id_ = id_;
+std::unique_ptr<Model> Model::clone(const CounterRng &rng) const {
+    // Shares every gene array; each side copies an array only when it writes to it. The
+    // clone compiles on first use, from the plan cache.
+    auto cloned = std::unique_ptr<Model>(new Model(inputs_, outputs_, Empty{}));
     cloned->fitness_ = fitness_;
+    cloned->nodes_ = nodes_;
+    cloned->connections_ = connections_;
     cloned->mutationConfig_ = mutationConfig_;
-
-    // Clone nodes
-    cloned->nodes_.clear();
-    for (const auto &[id, node] : nodes_) {
-        cloned->nodes_[id] = node->clone();
-    }
-
-    // Fix input/output pointers
-    cloned->inputNodes_.clear();
-    cloned->outputNodes_.clear();
-    for (auto &[id, node] : cloned->nodes_) {
-        if (node->isInput()) cloned->inputNodes_.push_back(node.get());
-        else if (!node->isHidden()) cloned->outputNodes_.push_back(node.get());
-    }
-
-    // Clone connections
-    cloned->connections_.clear();
-    for (const auto &[key, conn] : connections_) {
-        cloned->connections_[key] = conn->clone();
-    }
-
+    cloned->precision_ = precision_;
+    cloned->rng_ = rng;
     return cloned;
 }
-
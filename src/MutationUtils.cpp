@@ -0,0 +1,126 @@
+#include "Utils/MutationUtils.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SNAKE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    double mutateValue(const DoubleConfig &config, double value, double roll, double choice, double draw) {
+        if (roll >= config.mutation_rate) return value;
+        double range = config.max - config.min;
+        double x = choice < config.replace_rate ? config.min + draw * range
+                                                : value + (draw * 2.0 - 1.0) * config.mutation_power;
+        return std::min(config.max, std::max(config.min, x));
+    }
+
+    void mutateScalar(const DoubleConfig &config, const CounterRng &rng, uint32_t first,
+                      double *values, const uint8_t *mask, size_t n, size_t i) {
+        for (; i < n; ++i) {
+            if (mask && !mask[i]) continue;
+            auto counter = static_cast<uint32_t>(first + 3 * i);
+            values[i] = mutateValue(config, values[i], rng.uniform(counter), rng.uniform(counter + 1),
+                                    rng.uniform(counter + 2));
+        }
+    }
+
+    void kernelScalar(const DoubleConfig &config, const CounterRng &rng, uint32_t first,
+                      double *values, const uint8_t *mask, size_t n) {
+        mutateScalar(config, rng, first, values, mask, n, 0);
+    }
+
+#ifdef SNAKE_X86
+    // Same operations as the scalar path, without fused multiply-adds, so the bits match
+
+    __attribute__((target("avx2")))
+    __m256i mixAvx2(__m256i x) {
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+        x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7feb352d));
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+        x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(0x846ca68bU)));
+        return _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+    }
+
+    // CounterRng::uniform for 8 counters, as two halves of 4
+    __attribute__((target("avx2")))
+    void uniformAvx2(const CounterRng &rng, __m256i counters, __m256d &low, __m256d &high) {
+        __m256i bits = _mm256_xor_si256(counters, _mm256_set1_epi32(static_cast<int>(rng.getKey0())));
+        bits = mixAvx2(_mm256_add_epi32(mixAvx2(bits), _mm256_set1_epi32(static_cast<int>(rng.getKey1()))));
+        const __m256d scale = _mm256_set1_pd(0x1p-32), half = _mm256_set1_pd(0.5);
+        low = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(bits)), scale), half);
+        high = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(bits, 1)), scale), half);
+    }
+
+    __attribute__((target("avx2")))
+    __m256d mutateAvx2(const DoubleConfig &config, __m256d value, __m256d roll, __m256d choice, __m256d draw,
+                       const uint8_t *mask) {
+        const __m256d min = _mm256_set1_pd(config.min), max = _mm256_set1_pd(config.max);
+        __m256d fresh = _mm256_add_pd(min, _mm256_mul_pd(draw, _mm256_set1_pd(config.max - config.min)));
+        __m256d step = _mm256_sub_pd(_mm256_mul_pd(draw, _mm256_set1_pd(2.0)), _mm256_set1_pd(1.0));
+        __m256d moved = _mm256_add_pd(value, _mm256_mul_pd(step, _mm256_set1_pd(config.mutation_power)));
+        __m256d x = _mm256_blendv_pd(moved, fresh, _mm256_cmp_pd(choice, _mm256_set1_pd(config.replace_rate), _CMP_LT_OQ));
+        x = _mm256_min_pd(_mm256_max_pd(x, min), max);
+
+        __m256d take = _mm256_cmp_pd(roll, _mm256_set1_pd(config.mutation_rate), _CMP_LT_OQ);
+        if (mask) {
+            int32_t bytes;
+            std::memcpy(&bytes, mask, sizeof(bytes));
+            __m256i flags = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(bytes));
+            take = _mm256_andnot_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(flags, _mm256_setzero_si256())), take);
+        }
+        return _mm256_blendv_pd(value, x, take);
+    }
+
+    __attribute__((target("avx2")))
+    void kernelAvx2(const DoubleConfig &config, const CounterRng &rng, uint32_t first,
+                    double *values, const uint8_t *mask, size_t n) {
+        const __m256i lanes = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256i counters = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(first + 3 * i)), lanes);
+            __m256d roll[2], choice[2], draw[2];
+            uniformAvx2(rng, counters, roll[0], roll[1]);
+            uniformAvx2(rng, _mm256_add_epi32(counters, _mm256_set1_epi32(1)), choice[0], choice[1]);
+            uniformAvx2(rng, _mm256_add_epi32(counters, _mm256_set1_epi32(2)), draw[0], draw[1]);
+            for (int h = 0; h < 2; ++h) {
+                double *v = values + i + 4 * h;
+                _mm256_storeu_pd(v, mutateAvx2(config, _mm256_loadu_pd(v), roll[h], choice[h], draw[h],
+                                               mask ? mask + i + 4 * h : nullptr));
+            }
+        }
+        mutateScalar(config, rng, first, values, mask, n, i);
+    }
+#endif
+
+    using Kernel = void (*)(const DoubleConfig &, const CounterRng &, uint32_t, double *, const uint8_t *, size_t);
+
+    struct KernelChoice {
+        Kernel kernel;
+        const char *name;
+    };
+
+    KernelChoice chooseKernel() {
+#ifdef SNAKE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return {kernelAvx2, "avx2"};
+#endif
+        return {kernelScalar, "scalar"};
+    }
+
+    const KernelChoice &kernelChoice() {
+        static const KernelChoice choice = chooseKernel();
+        return choice;
+    }
+}
+
+void mutateArray(const DoubleConfig &config, const CounterRng &rng, uint32_t first,
+                 double *values, const uint8_t *mask, size_t n) {
+    kernelChoice().kernel(config, rng, first, values, mask, n);
+}
+
+const char *getMutationKernelName() {
+    return kernelChoice().name;
+}
@@ -0,0 +1,195 @@
+#include "Model/NativeCodegen.h"
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdio>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int NativeInputs = 11;
+    constexpr int NativeOutputs = 3;
+
+    std::string literal(double value) {
+        std::ostringstream oss;
+        oss << std::hexfloat << value;
+        return oss.str();
+    }
+
+    std::string activationExpr(ActivationType type, const std::string &x) {
+        switch (type) {
+            case ActivationType::Sigmoid:
+                return "1.0 / (1.0 + std::exp(-(" + x + ")))";
+            case ActivationType::ReLU:
+                return "relu(" + x + ")";
+            case ActivationType::Tanh:
+                return "std::tanh(" + x + ")";
+            default:
+                return x;
+        }
+    }
+
+    std::string compilerCommand() {
+        if (const char *cxx = std::getenv("SNAKE_CXX")) return cxx;
+        if (const char *cxx = std::getenv("CXX")) return cxx;
+        return "c++";
+    }
+
+    // A directory or regular file of this user that no one else can write, not a symlink
+    bool isPrivate(const std::filesystem::path &path, bool directory) {
+        struct stat st{};
+        if (lstat(path.c_str(), &st) != 0) return false;
+        if (directory ? !S_ISDIR(st.st_mode) : !S_ISREG(st.st_mode)) return false;
+        return st.st_uid == geteuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+    }
+
+    // $XDG_CACHE_HOME/snake-neat or ~/.cache/snake-neat, created 0700; empty if there is no
+    // home or the directory is not private
+    std::filesystem::path cacheDirectory() {
+        std::filesystem::path base;
+        if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg == '/')
+            base = xdg;
+        else if (const char *home = std::getenv("HOME"); home && *home == '/')
+            base = std::filesystem::path(home) / ".cache";
+        else
+            return {};
+
+        std::error_code ec;
+        std::filesystem::create_directories(base, ec);
+        auto dir = base / "snake-neat";
+        if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) return {};
+        return isPrivate(dir, true) ? dir : std::filesystem::path{};
+    }
+
+    // Entries hold the source they were built from; one only counts if it matches
+    bool holdsSource(const std::filesystem::path &entry, const std::string &source) {
+        if (!isPrivate(entry, true) || !isPrivate(entry / "policy.cpp", false) ||
+            !isPrivate(entry / "policy.so", false))
+            return false;
+        std::ifstream file(entry / "policy.cpp", std::ios::binary);
+        std::ostringstream stored;
+        stored << file.rdbuf();
+        return file && stored.str() == source;
+    }
+
+    NativeModule openModule(const std::filesystem::path &library, std::string &error) {
+        void *handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            error = dlerror();
+            return {};
+        }
+        auto forward = reinterpret_cast<NativeForward>(dlsym(handle, "snake_forward"));
+        if (!forward) {
+            dlclose(handle);
+            error = "snake_forward not found in " + library.string();
+            return {};
+        }
+        return NativeModule{handle, forward};
+    }
+}
+
+void exportNativeSource(const Phenotype &p, std::ostream &out) {
+    const PhenotypePlan &plan = *p.getPlan();
+    if (p.getPrecision() != Precision::Double)
+        throw std::invalid_argument("Native export needs a Double phenotype");
+    if (p.getInputCount() != NativeInputs || p.getOutputCount() != NativeOutputs)
+        throw std::invalid_argument("Native export needs an 11-input, 3-output network");
+    // The generated nodes call std::exp and std::tanh, so folded constants must be Exact too
+    if (p.getConstantMode() != ActivationMode::Exact)
+        throw std::invalid_argument("Native export needs a phenotype compiled in Exact activation mode");
+
+    out << "// Generated by exportNativeSource(), do not edit.\n"
+        << "#include <cmath>\n\n"
+        << "static inline double relu(double x) { return x > 0 ? x : 0; }\n\n"
+        << "extern \"C\" void snake_forward(const double *in, double *out) {\n";
+
+    for (int i = 0; i < plan.inputs; ++i) {
+        out << "    const double v" << i << " = in[" << i << "];\n";
+    }
+    for (int c = 0; c < plan.constants; ++c) {
+        out << "    const double v" << plan.inputs + c << " = " << literal(p.values_[plan.inputs + c]) << ";\n";
+    }
+
+    // Sums are emitted as the same left-to-right chain Phenotype::activate accumulates
+    const int computed = static_cast<int>(plan.activation.size());
+    const int base = plan.computedBase();
+    for (int n = 0; n < computed; ++n) {
+        std::string sum = literal(p.seed_[n]);
+        for (int e = plan.inStart[n]; e < plan.inStart[n + 1]; ++e) {
+            sum = "(" + sum + " + v" + std::to_string(plan.inSource[e]) + " * " + literal(p.inWeight_[e]) + ")";
+        }
+        sum = sum + " + " + literal(p.bias_[n]);
+        out << "    const double v" << base + n << " = " << activationExpr(plan.activation[n], sum) << ";\n";
+    }
+
+    for (int o = 0; o < NativeOutputs; ++o) {
+        out << "    out[" << o << "] = v" << plan.outputIndex[o] << ";\n";
+    }
+    out << "}\n";
+}
+
+NativeModule loadNativeModule(const Phenotype &phenotype, std::string *error) {
+    auto fail = [error](const std::string &message) {
+        if (error) *error = message;
+        return NativeModule{};
+    };
+
+    std::ostringstream source;
+    try {
+        exportNativeSource(phenotype, source);
+    } catch (const std::exception &e) {
+        return fail(e.what());
+    }
+
+    // Entries are keyed by a hash of the source and checked against the source itself, so a
+    // collision builds privately instead of loading another network
+    auto cache = cacheDirectory();
+    std::error_code ec;
+    auto parent = cache.empty() ? std::filesystem::temp_directory_path(ec) : cache;
+    std::string stem = "policy_" + std::to_string(std::hash<std::string>()(source.str()));
+    auto entry = cache.empty() ? std::filesystem::path{} : cache / stem;
+
+    std::string message;
+    if (!entry.empty() && holdsSource(entry, source.str())) {
+        NativeModule module = openModule(entry / "policy.so", message);
+        return module.forward ? module : fail(message);
+    }
+
+    // Build in a fresh 0700 directory, then install it as the entry with one rename; a
+    // rename onto an existing entry fails, so installed entries never change
+    std::string pattern = (parent / (stem + ".XXXXXX")).string();
+    if (!mkdtemp(pattern.data())) return fail("cannot create a build directory in " + parent.string());
+    std::filesystem::path build = pattern;
+    {
+        std::ofstream file(build / "policy.cpp", std::ios::binary);
+        file << source.str();
+        if (!file) {
+            std::filesystem::remove_all(build, ec);
+            return fail("cannot write " + (build / "policy.cpp").string());
+        }
+    }
+    std::string command = compilerCommand() + " -O2 -std=c++17 -shared -fPIC -o \"" +
+                          (build / "policy.so").string() + "\" \"" + (build / "policy.cpp").string() +
+                          "\" > /dev/null 2>&1";
+    if (std::system(command.c_str()) != 0) {
+        std::filesystem::remove_all(build, ec);
+        return fail("compiler failed: " + command);
+    }
+    chmod((build / "policy.cpp").c_str(), 0600);
+    chmod((build / "policy.so").c_str(), 0700);
+
+    NativeModule module = openModule(build / "policy.so", message);
+    if (!module.forward || entry.empty() || std::rename(build.c_str(), entry.c_str()) != 0)
+        std::filesystem::remove_all(build, ec);   // a loaded library stays mapped
+    return module.forward ? module : fail(message);
+}
+
+void unloadNativeModule(NativeModule &module) {
+    if (module.handle) dlclose(module.handle);
+    module = NativeModule{};
+}
@@ -0,0 +1,32 @@
+#include "SnakeGame/NativeInputProvider.h"
+#include <stdexcept>
+
+NativeInputProvider::NativeInputProvider(Model *model, bool render)
+        : fallback_(model, render), render_(render) {
+    model->compile(Precision::Double);
+    module_ = loadNativeModule(model->getPhenotype(), &error_);
+}
+
+NativeInputProvider::~NativeInputProvider() {
+    unloadNativeModule(module_);
+}
+
+Direction NativeInputProvider::getInput(std::vector<double> &inputs) {
+    if (!module_.forward)
+        return fallback_.getInput(inputs);
+
+    if (inputs.size() != 11)
+        throw std::invalid_argument("Input size mismatch");
+    if (render_) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {}
+    }
+
+    double outputs[3];
+    module_.forward(inputs.data(), outputs);
+    int maxIndex = 0;
+    for (int i = 1; i < 3; ++i) {
+        if (outputs[i] > outputs[maxIndex]) maxIndex = i;
+    }
+    return static_cast<Direction>(maxIndex);
+}
@@ -0,0 +1,317 @@
+#include "Model/Phenotype.h"
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <cstring>
+#include <omp.h>
+
+namespace {
+    constexpr size_t BatchBlock = 64;
+
+    // Grows but never shrinks, so evaluation stops allocating after the first call per thread
+    template<typename T>
+    T *scratch(size_t size) {
+        thread_local std::vector<T> buffer;
+        if (buffer.size() < size) buffer.resize(size);
+        return buffer.data();
+    }
+
+    bool sameBits(double a, double b) {
+        uint64_t x, y;
+        std::memcpy(&x, &a, sizeof(x));
+        std::memcpy(&y, &b, sizeof(y));
+        return x == y;
+    }
+}
+
+Phenotype::Phenotype() {
+    static const auto empty = std::make_shared<const PhenotypePlan>();
+    plan_ = empty;
+}
+
+Phenotype::Phenotype(std::shared_ptr<const PhenotypePlan> plan) : plan_(std::move(plan)) {}
+
+void Phenotype::activate(const double *inputs, double *outputs) const {
+    switch (precision_) {
+        case Precision::Double:
+            run(inputs, values_.data(), bias_.data(), seed_.data(), inWeight_.data(), outputs);
+            break;
+        case Precision::Float:
+            run(inputs, valuesF_.data(), biasF_.data(), seedF_.data(), inWeightF_.data(), outputs);
+            break;
+        case Precision::Int8:
+            run(inputs, valuesF_.data(), biasF_.data(), seedF_.data(), inWeightQ_.data(), outputs);
+            break;
+    }
+}
+
+void Phenotype::activate(const std::vector<double> &inputs, std::vector<double> &outputs) const {
+    const PhenotypePlan &plan = *plan_;
+    if (inputs.size() != static_cast<size_t>(plan.inputs))
+        throw std::invalid_argument("Input size mismatch");
+    outputs.resize(plan.outputIndex.size());
+    activate(inputs.data(), outputs.data());
+}
+
+template<typename Value, typename Weight>
+void Phenotype::run(const double *inputs, const Value *constants, const Value *bias, const Value *seed,
+                    const Weight *weight, double *outputs) const {
+    const PhenotypePlan &plan = *plan_;
+    const int base = plan.computedBase();
+    Value *values = scratch<Value>(getNodeCount());
+    for (int i = 0; i < plan.inputs; ++i) {
+        values[i] = static_cast<Value>(inputs[i]);
+    }
+    std::copy(constants + plan.inputs, constants + base, values + plan.inputs);
+
+    const int *source = plan.inSource.data();
+    const int computed = static_cast<int>(plan.activation.size());
+    const ActivationMode mode = getActivationMode();
+    // Int8 rows accumulate the integer weights and apply the network scale once
+    constexpr bool quantized = std::is_same_v<Weight, int8_t>;
+    for (int n = 0; n < computed; ++n) {
+        Value sum = quantized ? 0 : seed[n];
+        for (int e = plan.inStart[n]; e < plan.inStart[n + 1]; ++e) {
+            sum += values[source[e]] * static_cast<Value>(weight[e]);
+        }
+        if constexpr (quantized)
+            sum = seed[n] + sum * weightScale_;
+        values[base + n] = applyActivation(plan.activation[n], sum + bias[n], mode);
+    }
+
+    for (size_t i = 0; i < plan.outputIndex.size(); ++i) {
+        outputs[i] = values[plan.outputIndex[i]];
+    }
+}
+
+void Phenotype::activateBatch(const double *inputs, size_t rows, double *outputs) const {
+    const PhenotypePlan &plan = *plan_;
+    const size_t blocks = (rows + BatchBlock - 1) / BatchBlock;
+    const size_t inCount = plan.inputs, outCount = plan.outputIndex.size();
+
+#pragma omp parallel for schedule(static) if (blocks > 4)
+    for (size_t b = 0; b < blocks; ++b) {
+        const size_t first = b * BatchBlock;
+        const size_t count = std::min(BatchBlock, rows - first);
+        if (precision_ == Precision::Double) {
+            runBlock(inputs + first * inCount, count, outputs + first * outCount);
+            continue;
+        }
+        for (size_t r = first; r < first + count; ++r) {
+            activate(inputs + r * inCount, outputs + r * outCount);
+        }
+    }
+}
+
+void Phenotype::runBlock(const double *inputs, size_t rows, double *outputs) const {
+    const PhenotypePlan &plan = *plan_;
+    // values[slot][row], with the same per-row operation order as run()
+    const int base = plan.computedBase();
+    double *values = scratch<double>(getNodeCount() * BatchBlock);
+    for (int i = 0; i < plan.inputs; ++i) {
+        double *row = values + i * rows;
+        for (size_t r = 0; r < rows; ++r) row[r] = inputs[r * plan.inputs + i];
+    }
+    for (int c = plan.inputs; c < base; ++c) {
+        std::fill(values + c * rows, values + (c + 1) * rows, values_[c]);
+    }
+
+    const int computed = static_cast<int>(plan.activation.size());
+    for (int n = 0; n < computed; ++n) {
+        double *__restrict out = values + (base + n) * rows;
+        std::fill(out, out + rows, seed_[n]);
+        for (int e = plan.inStart[n]; e < plan.inStart[n + 1]; ++e) {
+            const double *__restrict src = values + plan.inSource[e] * rows;
+            const double w = inWeight_[e];
+            for (size_t r = 0; r < rows; ++r) out[r] += src[r] * w;
+        }
+        const double bias = bias_[n];
+        for (size_t r = 0; r < rows; ++r) out[r] += bias;
+        activateArray(plan.activation[n], out, rows);
+    }
+
+    const size_t outCount = plan.outputIndex.size();
+    for (size_t o = 0; o < outCount; ++o) {
+        const double *row = values + plan.outputIndex[o] * rows;
+        for (size_t r = 0; r < rows; ++r) outputs[r * outCount + o] = row[r];
+    }
+}
+
+void Phenotype::activateIncremental(IncrementalState &state, const std::vector<double> &inputs,
+                                    std::vector<double> &outputs) const {
+    const PhenotypePlan &plan = *plan_;
+    const long fullMacs = static_cast<long>(plan.inSource.size());
+    state.fullMacs += fullMacs;
+    if (precision_ != Precision::Double) {
+        activate(inputs, outputs);
+        state.macs += fullMacs;
+        return;
+    }
+    if (inputs.size() != static_cast<size_t>(plan.inputs))
+        throw std::invalid_argument("Input size mismatch");
+
+    const int slots = getNodeCount();
+    const int computed = static_cast<int>(plan.activation.size());
+    const int base = plan.computedBase();
+    if (!state.primed) {
+        // Everything counts as changed, so the sweep below is a full evaluation.
+        // Starting from values_ brings the constant slots along.
+        state.values.assign(values_.begin(), values_.end());
+        state.prefix.assign(plan.inSource.size(), 0.0);
+        state.changed.assign(slots, 1);
+        state.dirty.assign(computed, 1);
+        state.primed = true;
+        std::copy(inputs.begin(), inputs.end(), state.values.begin());
+    } else {
+        std::fill(state.changed.begin(), state.changed.end(), 0);
+    }
+
+    double *values = state.values.data();
+    double *prefix = state.prefix.data();
+    uint8_t *changed = state.changed.data();
+    uint8_t *dirty = state.dirty.data();
+    auto markConsumers = [&](int slot) {
+        changed[slot] = 1;
+        for (int c = plan.outStart[slot]; c < plan.outStart[slot + 1]; ++c) dirty[plan.outTarget[c]] = 1;
+    };
+
+    for (int i = 0; i < plan.inputs; ++i) {
+        if (sameBits(values[i], inputs[i])) continue;
+        values[i] = inputs[i];
+        markConsumers(i);
+    }
+
+    // Consumers always sit after their sources, so one forward sweep settles everything.
+    // A dirty row resumes from the running sum stored before its first changed source,
+    // which is exactly the partial sum a full evaluation would have reached there.
+    const int *source = plan.inSource.data();
+    const double *weight = inWeight_.data();
+    const ActivationMode mode = getActivationMode();
+    for (int n = 0; n < computed; ++n) {
+        if (!dirty[n]) continue;
+        dirty[n] = 0;
+
+        int e = plan.inStart[n];
+        const int end = plan.inStart[n + 1];
+        while (e < end && !changed[source[e]]) ++e;
+        double sum = e > plan.inStart[n] ? prefix[e - 1] : seed_[n];
+        state.macs += end - e;
+        for (; e < end; ++e) {
+            sum += values[source[e]] * weight[e];
+            prefix[e] = sum;
+        }
+
+        double value = applyActivation(plan.activation[n], sum + bias_[n], mode);
+        if (sameBits(values[base + n], value)) continue;
+        values[base + n] = value;
+        markConsumers(base + n);
+    }
+
+    outputs.resize(plan.outputIndex.size());
+    for (size_t i = 0; i < plan.outputIndex.size(); ++i) {
+        outputs[i] = values[plan.outputIndex[i]];
+    }
+}
+
+void Phenotype::setPrecision(Precision precision) {
+    if (precision == precision_)
+        return;
+    if (precision_ != Precision::Double)
+        throw std::logic_error("Phenotype precision can only be lowered from Double");
+
+    valuesF_.assign(values_.begin(), values_.end());
+    biasF_.assign(bias_.begin(), bias_.end());
+    seedF_.assign(seed_.begin(), seed_.end());
+
+    if (precision == Precision::Float) {
+        inWeightF_.assign(inWeight_.begin(), inWeight_.end());
+    } else {
+        double maxAbs = 0.0;
+        for (double w : inWeight_) maxAbs = std::max(maxAbs, std::abs(w));
+        weightScale_ = maxAbs > 0.0 ? static_cast<float>(maxAbs / 127.0) : 1.0f;
+        inWeightQ_.resize(inWeight_.size());
+        for (size_t e = 0; e < inWeight_.size(); ++e) {
+            double q = std::round(inWeight_[e] / weightScale_);
+            inWeightQ_[e] = static_cast<int8_t>(std::min(127.0, std::max(-127.0, q)));
+        }
+    }
+
+    std::vector<double>().swap(values_);
+    std::vector<double>().swap(bias_);
+    std::vector<double>().swap(seed_);
+    std::vector<double>().swap(inWeight_);
+    precision_ = precision;
+}
+
+double Phenotype::getWeight(int edge) const {
+    switch (precision_) {
+        case Precision::Float:
+            return inWeightF_[edge];
+        case Precision::Int8:
+            return static_cast<double>(inWeightQ_[edge]) * weightScale_;
+        default:
+            return inWeight_[edge];
+    }
+}
+
+double Phenotype::getBias(int node) const {
+    return precision_ == Precision::Double ? bias_[node] : biasF_[node];
+}
+
+double Phenotype::getSeed(int node) const {
+    return precision_ == Precision::Double ? seed_[node] : seedF_[node];
+}
+
+double Phenotype::getConstant(int constant) const {
+    int slot = plan_->inputs + constant;
+    return precision_ == Precision::Double ? values_[slot] : valuesF_[slot];
+}
+
+bool Phenotype::hasSameTopology(const Phenotype &other) const {
+    const PhenotypePlan &plan = *plan_, &otherPlan = *other.plan_;
+    if (plan_ == other.plan_)
+        return true;
+    return plan.topologyHash == otherPlan.topologyHash &&
+           plan.inputs == otherPlan.inputs &&
+           plan.constants == otherPlan.constants &&
+           plan.activation == otherPlan.activation &&
+           plan.inStart == otherPlan.inStart &&
+           plan.inSource == otherPlan.inSource &&
+           plan.outputIndex == otherPlan.outputIndex;
+}
+
+size_t PhenotypePlan::getBytes() const {
+    auto bytes = [](const auto &v) { return v.capacity() * sizeof(v[0]); };
+    return sizeof(*this) + bytes(activation) + bytes(inStart) + bytes(inSource) + bytes(outputIndex) +
+           bytes(outStart) + bytes(outTarget) + bytes(edgeGene) + bytes(rowNode) + bytes(constNode) +
+           bytes(constStart) + bytes(constSource) + bytes(seedStart) + bytes(seedSource) +
+           bytes(constGene) + bytes(seedGene);
+}
+
+void PhenotypePlan::indexConsumers() {
+    const int slots = computedBase() + static_cast<int>(activation.size());
+    outStart.assign(slots + 1, 0);
+    for (int source : inSource) outStart[source + 1]++;
+    for (int s = 0; s < slots; ++s) outStart[s + 1] += outStart[s];
+
+    outTarget.resize(inSource.size());
+    std::vector<int> fill(outStart.begin(), outStart.end() - 1);
+    const int computed = static_cast<int>(activation.size());
+    for (int n = 0; n < computed; ++n) {
+        for (int e = inStart[n]; e < inStart[n + 1]; ++e) {
+            outTarget[fill[inSource[e]]++] = n;
+        }
+    }
+}
+
+void PhenotypePlan::hashTopology() {
+    size_t h = std::hash<int>()(inputs);
+    auto mix = [&h](size_t v) { h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2); };
+    mix(constants);
+    for (auto act : activation) mix(static_cast<size_t>(act));
+    for (int v : inStart) mix(v);
+    for (int v : inSource) mix(v);
+    for (int v : outputIndex) mix(v);
+    topologyHash = h;
+}
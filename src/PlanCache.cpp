@@ -0,0 +1,76 @@
+#include "Model/PlanCache.h"
+
+PlanCache &PlanCache::global() {
+    static PlanCache cache;
+    return cache;
+}
+
+std::shared_ptr<const PhenotypePlan> PlanCache::find(size_t hash, const std::vector<int> &key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto range = index_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->key != key)
+            continue;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        stats_.hits++;
+        return it->second->plan;
+    }
+    stats_.misses++;
+    return nullptr;
+}
+
+void PlanCache::insert(size_t hash, std::vector<int> key, std::shared_ptr<const PhenotypePlan> plan) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (budget_ == 0)
+        return;
+
+    // Another thread may have compiled the same structure in the meantime
+    auto range = index_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->key == key)
+            return;
+    }
+
+    size_t bytes = plan->getBytes() + key.capacity() * sizeof(int) + sizeof(Entry);
+    lru_.push_front(Entry{hash, std::move(key), std::move(plan), bytes});
+    index_.emplace(hash, lru_.begin());
+    stats_.entries++;
+    stats_.bytes += bytes;
+    evict();
+}
+
+void PlanCache::setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes;
+    evict();
+}
+
+void PlanCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    stats_.entries = 0;
+    stats_.bytes = 0;
+}
+
+PlanCacheStats PlanCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void PlanCache::evict() {
+    while (stats_.bytes > budget_ && !lru_.empty()) {
+        Entry &victim = lru_.back();
+        auto range = index_.equal_range(victim.hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == std::prev(lru_.end())) {
+                index_.erase(it);
+                break;
+            }
+        }
+        stats_.bytes -= victim.bytes;
+        stats_.entries--;
+        stats_.evictions++;
+        lru_.pop_back();
+    }
+}
@@ -1,4 +1,7 @@
 #include "Model/Population.h"
+#include "Model/PlanCache.h"
+#include "Model/InnovationRegistry.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
@@ -8,12 +11,58 @@
 #include <omp.h>
 
 
-Population::Population(int size) {
+Population::Population(int size, uint64_t seed) : rng_(seed) {
     inputs_ = 11;
     outputs_ = 3;
     size_ = size;
+    CounterRng offspring = stream(0, Offspring);
     for (int i = 0; i < size; ++i) {
-        individuals_.emplace_back(std::make_unique<Individual>(inputs_, outputs_));
+        individuals_.emplace_back(std::make_unique<Individual>(inputs_, outputs_, offspring.split(i)));
+    }
+}
+
+void Population::evaluate() {
+    CounterRng evaluation = stream(generation_, Evaluation);
+    if (evaluation_.lockstep && evaluation_.precision == Precision::Double) {
+        // Chunks of the population play in lockstep; a game's score does not depend on its chunk
+        const int slots = std::max(evaluation_.lockstepSlots, 1);
+        const int chunks = (static_cast<int>(individuals_.size()) + slots - 1) / slots;
+#pragma omp parallel for schedule(dynamic)
+        for (int c = 0; c < chunks; ++c) {
+            std::vector<Individual *> chunk;
+            std::vector<Model *> models;
+            std::vector<CounterRng> streams;
+            for (int i = c * slots; i < std::min((c + 1) * slots, static_cast<int>(individuals_.size())); ++i) {
+                if (!individuals_[i]) continue;
+                chunk.push_back(individuals_[i].get());
+                models.push_back(individuals_[i]->getModel());
+                streams.push_back(evaluation.split(i));
+            }
+
+            VectorEnv env(Game::toCells(800), Game::toCells(800), slots);
+            std::vector<double> scores;
+            env.run(models, streams, Individual::Episodes, scores);
+            for (size_t i = 0; i < chunk.size(); ++i) chunk[i]->setFitness(scores[i]);
+        }
+        return;
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < individuals_.size(); ++i) {
+        if (!individuals_[i]) {
+//                throw std::runtime_error("individual null!!");
+            std::cout << "null individual" << std::endl;
+            continue;
+        }
+        individuals_[i]->train(0, evaluation_, evaluation.split(i));
+    }
+}
+
+void Population::evolve(int generations) {
+    for (int g = 0; g < generations; ++g) {
+        evaluate();
+        crossover();
+        generation_++;
     }
 }
 
@@ -23,15 +72,33 @@ void Population::train(Renderer *renderer) {
 //    double decayRate = 0.995;
 
     while (true) {
+        PlanCacheStats plansBefore = PlanCache::global().getStats();
 
-#pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < individuals_.size(); ++i) {
-            if (!individuals_[i]) {
-//                throw std::runtime_error("individual null!!");
-                std::cout << "null individual" << std::endl;
-                continue;
+        evaluate();
+
+        double cacheHitRate = 0.0;
+        if (evaluation_.decisionCacheEntries > 0) {
+            long hits = 0, lookups = 0;
+            for (const auto &individual: individuals_) {
+                const auto &cache = individual->getPolicy().getDecisionCache();
+                hits += cache.getHits();
+                lookups += cache.getHits() + cache.getMisses() + cache.getBypassed();
             }
-            individuals_[i]->train(0);
+            cacheHitRate = lookups ? 100.0 * hits / lookups : 0.0;
+        }
+
+        PlanCacheStats plans = PlanCache::global().getStats();
+        long planHits = plans.hits - plansBefore.hits;
+        long planLookups = planHits + plans.misses - plansBefore.misses;
+
+        CompileStats compiled;
+        for (const auto &individual: individuals_) {
+            const auto &stats = individual->getModel()->getPhenotype().getCompileStats();
+            compiled.genomeNodes += stats.genomeNodes;
+            compiled.genomeEdges += stats.genomeEdges;
+            compiled.nodes += stats.nodes;
+            compiled.edges += stats.edges;
+            compiled.folded += stats.folded;
         }
 //        std::cout << "training done: " << generation_ << " num_species: " << currMaxSpecies_ << std::endl;
 //        speciate();
@@ -60,7 +127,16 @@ void Population::train(Renderer *renderer) {
             }
         }
         std::cout << "generation: " << generation_++ << " num_species: " << currMaxSpecies_
-                  << " fitness: " << getFittest()->getFitness() << std::endl;
+                  << " fitness: " << getFittest()->getFitness()
+                  << " nodes: " << compiled.genomeNodes << " -> " << compiled.nodes
+                  << " (" << compiled.folded << " folded)"
+                  << " edges: " << compiled.genomeEdges << " -> " << compiled.edges
+                  << " plan hits: " << planHits << "/" << planLookups
+                  << " evictions: " << plans.evictions - plansBefore.evictions
+                  << " innovations: " << InnovationRegistry::global().size();
+        if (evaluation_.decisionCacheEntries > 0)
+            std::cout << " cache hit rate: " << cacheHitRate << "%";
+        std::cout << std::endl;
     }
 }
 
@@ -301,12 +377,13 @@ void Population::crossover() {
     }
 
     std::discrete_distribution<int> weightedDist(fitnessWeights.begin(), fitnessWeights.end());
+    CounterRng selection = stream(generation_, Selection), offspring = stream(generation_ + 1, Offspring);
 
     while (newGeneration.size() < individuals_.size()) {
-        int idx1 = weightedDist(rng_);
-        int idx2 = weightedDist(rng_);
+        int idx1 = weightedDist(selection);
+        int idx2 = weightedDist(selection);
         while (idx2 == idx1) {
-            idx2 = weightedDist(rng_);
+            idx2 = weightedDist(selection);
         }
 
         auto& parent1 = newGeneration[idx1];
@@ -315,13 +392,29 @@ void Population::crossover() {
         auto m1 = parent1->getModel();
         auto m2 = parent2->getModel();
 
-        auto childModel = m1->crossover(m2);
+        auto childModel = m1->crossover(m2, offspring.split(newGeneration.size()));
         childModel->mutate();
 
         newGeneration.emplace_back(std::make_unique<Individual>(std::move(childModel)));
     }
 
     individuals_ = std::move(newGeneration);
+    pruneInnovations();
+}
+
+void Population::pruneInnovations() {
+    std::unordered_set<int> connections, nodes;
+    auto collect = [&](Model *model) {
+        const ConnectionGenes &genes = model->getConnections();
+        connections.insert(genes.innovation.begin(), genes.innovation.end());
+        const NodeGenes &ids = model->getNodes();
+        nodes.insert(ids.id.begin(), ids.id.end());
+    };
+    for (const auto &individual: individuals_)
+        if (individual) collect(individual->getModel());
+    for (const auto &species: species_)
+        if (species.representative) collect(species.representative->getModel());
+    InnovationRegistry::global().prune(connections, nodes);
 }
 
 
@@ -335,7 +428,9 @@ void Population::speciate() {
         s.clear();
 
     // Assign individuals to species
-    for (auto &individual: individuals_) {
+    const CounterRng founders = stream(generation_, Founder);
+    for (size_t i = 0; i < individuals_.size(); ++i) {
+        auto &individual = individuals_[i];
         if (!individual)
             continue;
         bool added = false;
@@ -350,7 +445,7 @@ void Population::speciate() {
         }
 
         if (!added) {
-            species_.emplace_back(individual.get()); // new species with this as representative
+            species_.emplace_back(individual.get(), founders.split(i)); // new species with this as representative
         }
     }
 
@@ -388,7 +483,8 @@ void Population::speciate() {
     }
 
     // Set new representative for next generation
+    CounterRng representatives = stream(generation_, Representative);
     for (auto &s: species_) {
-        s.chooseNewRepresentative();  // Implement this method
+        s.chooseNewRepresentative(representatives);  // Implement this method
     }
 }
@@ -0,0 +1,125 @@
+#include "SnakeGame/Sensors.h"
+#include <array>
+#include <cmath>
+#include <tuple>
+#include <vector>
+
+namespace {
+    // sin and cos of the angle from the heading to the food for every food offset up to Reach
+    // cells and every heading, computed once with the same expressions Game::getInputs() used
+    // per step, so the values match to the bit
+    template<int Reach>
+    class FoodAngles {
+    public:
+        static constexpr int Span = 2 * Reach + 1;
+
+        FoodAngles() : table_(4 * Span * Span) {
+            const std::array<std::pair<int, int>, 4> headings = {
+                    std::make_pair(1, 0), std::make_pair(-1, 0), std::make_pair(0, -1), std::make_pair(0, 1)};
+            for (const auto &dir: headings) {
+                for (int dy = -Reach; dy <= Reach; ++dy) {
+                    for (int dx = -Reach; dx <= Reach; ++dx) {
+                        double angleToFood = std::atan2(dy, dx);
+                        double angleSnake = std::atan2(dir.second, dir.first);
+                        double relAngle = angleToFood - angleSnake;
+                        table_[index(dx, dy, dir.first, dir.second)] = {std::sin(relAngle), std::cos(relAngle)};
+                    }
+                }
+            }
+        }
+
+        [[nodiscard]] const std::pair<double, double> &at(int dx, int dy, int dirX, int dirY) const {
+            return table_[index(dx, dy, dirX, dirY)];
+        }
+
+    private:
+        std::vector<std::pair<double, double>> table_;
+
+        static int index(int dx, int dy, int dirX, int dirY) {
+            int heading = dirX != 0 ? (dirX > 0 ? 0 : 1) : (dirY < 0 ? 2 : 3);
+            return (heading * Span + dy + Reach) * Span + dx + Reach;
+        }
+    };
+
+    template<int Reach>
+    const FoodAngles<Reach> &foodAngles() {
+        static const FoodAngles<Reach> table;
+        return table;
+    }
+
+    // Food offsets reach one past the board, for a head that just left it; a fixed board
+    // gets a table of its own size, small enough to stay in cache
+    template<typename Board>
+    struct AngleReach {
+        static constexpr int value = Bitboard::MaxSize;
+    };
+
+    template<int Cols, int Rows>
+    struct AngleReach<FixedBoard<Cols, Rows>> {
+        static constexpr int value = Cols > Rows ? Cols : Rows;
+    };
+}
+
+template<typename Board>
+void senseState(Board board, const Bitboard &occupied, std::pair<int, int> head, std::pair<int, int> dir,
+                std::pair<int, int> food, double *inputs) {
+    // Calculate left and right directions relative to snake
+    std::pair<int, int> front = dir;
+    std::pair<int, int> left = {dir.second, -dir.first};   // 90 deg counterclockwise
+    std::pair<int, int> right = {-dir.second, dir.first};  // 90 deg clockwise
+
+    const std::array<std::pair<int, int>, 3> relDirs = {front, left, right};
+
+    // The head is off the board only on the last step, and then every ray leaves it at once
+    bool onBoard = board.onBoard(head.first, head.second);
+    int foodX = food.first - head.first;
+    int foodY = food.second - head.second;
+
+    // Helper: scan in a direction and return (wallDist, bodyDist, foodFound). Rays run along a
+    // row or column, so the first body cell is a bit scan of that row's or column's mask.
+    auto scan = [&](std::pair<int, int> d) -> std::tuple<double, double, double> {
+        if (!onBoard)
+            return {1.0, 0.0, 0.0};
+
+        // Steps until the ray leaves the board
+        int steps = d.first > 0 ? board.cols() - head.first
+                  : d.first < 0 ? head.first + 1
+                  : d.second > 0 ? board.rows() - head.second
+                  : head.second + 1;
+        double wallDist = 1.0 / steps;  // Inverse: closer = higher
+
+        int bodySteps = occupied.nearest(head.first, head.second, d.first, d.second);
+        double bodyDist = bodySteps ? 1.0 / bodySteps : 0.0;  // Inverse: closer = higher
+
+        bool ahead = d.first != 0 ? foodY == 0 && foodX * d.first > 0 : foodX == 0 && foodY * d.second > 0;
+        double foodFound = ahead ? 1.0 : 0.0;
+        return {wallDist, bodyDist, foodFound};
+    };
+
+    // Scan front, left, right
+    for (auto& d : relDirs) {
+        auto [wallDist, bodyDist, foodFound] = scan(d);
+        *inputs++ = wallDist;
+        *inputs++ = bodyDist;
+        *inputs++ = foodFound;
+    }
+
+    // Food angle relative to snake heading
+    const auto &angle = foodAngles<AngleReach<Board>::value>().at(foodX, foodY, dir.first, dir.second);
+    inputs[0] = angle.first;   // sin, -1 to 1
+    inputs[1] = angle.second;  // cos, -1 to 1
+}
+
+template void senseState(Board20, const Bitboard &, std::pair<int, int>, std::pair<int, int>, std::pair<int, int>,
+                         double *);
+template void senseState(Board40, const Bitboard &, std::pair<int, int>, std::pair<int, int>, std::pair<int, int>,
+                         double *);
+template void senseState(Board64, const Bitboard &, std::pair<int, int>, std::pair<int, int>, std::pair<int, int>,
+                         double *);
+template void senseState(DynamicBoard, const Bitboard &, std::pair<int, int>, std::pair<int, int>,
+                         std::pair<int, int>, double *);
+
+void senseState(const Bitboard &occupied, int cols, int rows, std::pair<int, int> head, std::pair<int, int> dir,
+                std::pair<int, int> food, double *inputs) {
+    withBoard(cols, rows, [&](auto board) { senseState(board, occupied, head, dir, food, inputs); });
+}
@@ -1,45 +1,43 @@
 #include "SnakeGame/Snake.h"
+#include <array>
+#include <stdexcept>
 
 
-Snake::Snake(int startX, int startY) {
+Snake::Snake(int cols, int rows) : cols_(cols), rows_(rows) {
+    if (cols > Bitboard::MaxSize || rows > Bitboard::MaxSize)
+        throw std::invalid_argument("Board larger than 64 x 64");
+
+    // A full board plus the start segments that may hang off it
+    size_t capacity = 1;
+    while (capacity < static_cast<size_t>(cols * rows) + 4) capacity <<= 1;
+    cells_.resize(capacity);
+    mask_ = capacity - 1;
+}
+
+std::pair<int, int> Snake::getHeading(int direction) {
     static const std::array<std::pair<int, int>, 4> directions = {
             std::make_pair(1, 0),   // Right
             std::make_pair(-1, 0),  // Left
             std::make_pair(0, -1),  // Up
             std::make_pair(0, 1)    // Down
     };
+    return directions[direction];
+}
 
-    // Pick a random direction
-    static std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<int> dist(0, 3);
-    auto dir = directions[dist(rng)];
+void Snake::reset(int startX, int startY, int direction) {
+    auto dir = getHeading(direction);
 
     dirX_ = dir.first;
     dirY_ = dir.second;
-
-    // Initialize 3 blocks in the opposite direction of movement
-    for (int i = 0; i < 4; ++i) {
-        int x = startX - i * dirX_;
-        int y = startY - i * dirY_;
-        body_.emplace_back(x, y);
-        positions_.insert({x, y});
-    }
-}
-
-void Snake::move() {
-    auto head = body_.front();
-    head.first += dirX_;
-    head.second += dirY_;
-
-    body_.push_front(head);
-    positions_.insert(head);
-
-    if (growAmount_ > 0) {
-        growAmount_--;
-    } else {
-        auto tail = body_.back();
-        body_.pop_back();
-        positions_.erase(tail);
+    growAmount_ = 0;
+    bodyCollided_ = false;
+    occupied_.clear();
+    free_.reset(cols_ * rows_);
+    length_ = 0;
+
+    // Initialize 3 blocks in the opposite direction of movement, tail first
+    for (int i = 3; i >= 0; --i) {
+        push(DynamicBoard{cols_, rows_}, startX - i * dirX_, startY - i * dirY_);
     }
 }
 
@@ -79,32 +77,6 @@ void Snake::grow() {
     growAmount_++;
 }
 
-bool Snake::checkCollision(int gridWidth, int gridHeight, bool *bodyCollided) const {
-    auto head = getHead();
-
-    // Wall collision
-    if (head.first < 0 || head.first >= gridWidth ||
-        head.second < 0 || head.second >= gridHeight)
-        return true;
-
-    // Self-collision — skip head
-    if (positions_.count(head) > 1) {
-        *bodyCollided = true;
-        return true;
-    }
-
-    return false;
-}
-
-
-const std::deque<std::pair<int, int> > &Snake::getBody() const {
-    return body_;
-}
-
-const std::pair<int, int> &Snake::getHead() const {
-    return body_.front();
-}
-
 std::pair<int, int> Snake::getDir() {
     return std::make_pair(dirX_, dirY_);
 }
@@ -0,0 +1,230 @@
+#include "SnakeGame/VectorEnv.h"
+#include "SnakeGame/Game.h"
+#include "SnakeGame/Sensors.h"
+#include "SnakeGame/InputProvider.h"
+#include "Model/Model.h"
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+// History entries hold cell indices as int16_t
+static_assert(Bitboard::MaxSize * Bitboard::MaxSize - 1 <= std::numeric_limits<int16_t>::max(),
+              "Board cells must fit the head history");
+
+VectorEnv::VectorEnv(int cols, int rows, int slots) : cols_(cols), rows_(rows), slots_(std::max(slots, 1)) {
+    if (cols > Bitboard::MaxSize || rows > Bitboard::MaxSize)
+        throw std::invalid_argument("Board larger than 64 x 64");
+
+    // Same body capacity as Snake: a full board plus the start segments off it
+    capacity_ = 1;
+    while (capacity_ < static_cast<size_t>(cols * rows) + 4) capacity_ <<= 1;
+
+    const size_t board = static_cast<size_t>(cols_) * rows_;
+    // The loop window keeps at most length * 10 + 1 heads, and at most 3 start segments lie
+    // off the board, so length stays within board + 3
+    historyCapacity_ = (board + 3) * 10 + 1;
+    item_.assign(slots_, -1);
+    rng_.resize(slots_);
+    for (auto *column: {&headX_, &headY_, &dirX_, &dirY_, &foodX_, &foodY_,
+                        &length_, &grow_, &steps_, &hunger_, &overVisited_})
+        column->assign(slots_, 0);
+    bodyCollided_.assign(slots_, 0);
+    cells_.resize(slots_ * capacity_);
+    bodyHead_.assign(slots_, 0);
+    occupied_.resize(slots_);
+    free_.resize(slots_);
+    visits_.resize(slots_ * board);
+    history_.resize(slots_ * historyCapacity_);
+    historyStart_.assign(slots_, 0);
+    historySize_.assign(slots_, 0);
+    inputs_.resize(slots_ * SensorCount);
+}
+
+void VectorEnv::run(const std::vector<Model *> &models, const std::vector<CounterRng> &streams, int episodes,
+                    std::vector<double> &scores) {
+    if (streams.size() != models.size())
+        throw std::invalid_argument("One stream per model");
+    const size_t count = models.size();
+    scores.assign(count, 0.0);
+    if (count == 0 || episodes <= 0)
+        return;
+
+    std::vector<Phenotype *> phenotypes(count);
+    for (size_t i = 0; i < count; ++i) {
+        models[i]->compile(Precision::Double);
+        phenotypes[i] = &models[i]->getPhenotype();
+    }
+    outputs_.resize(slots_ * models.front()->getOutputCount());
+
+    // Episode e of model i is item i * episodes + e, so a model's episodes tend to share a
+    // batch and its bucket
+    std::vector<double> score(count * episodes, 0.0);
+    withBoard(cols_, rows_, [&](auto board) { play(board, phenotypes, streams, episodes, score); });
+
+    // Summed in episode order, as Individual::train does
+    for (size_t i = 0; i < count; ++i) {
+        double total = 0.0;
+        for (int e = 0; e < episodes; ++e) total += score[i * episodes + e];
+        scores[i] = total / episodes;
+    }
+}
+
+template<typename Board>
+void VectorEnv::play(Board board, const std::vector<Phenotype *> &phenotypes, const std::vector<CounterRng> &streams,
+                     int episodes, std::vector<double> &score) {
+    const int outputCount = phenotypes.front()->getOutputCount();
+    const long items = static_cast<long>(score.size());
+    long next = 0;
+    size_t live = 0;
+    item_.assign(slots_, -1);
+    lanes_.clear();
+
+    const size_t cells = static_cast<size_t>(board.cols()) * board.rows();
+    while (next < items || live > 0) {
+        // Refill idle slots and drop finished rows, amortized over a quarter of the batch
+        if (live * 4 <= lanes_.size() * 3) {
+            lanes_.clear();
+            lanePhenotypes_.clear();
+            for (size_t s = 0; s < slots_; ++s) {
+                if (item_[s] < 0 && next < items) {
+                    item_[s] = next++;
+                    startEpisode(s, streams[item_[s] / episodes].split(item_[s] % episodes));
+                    live++;
+                }
+                if (item_[s] < 0) continue;
+                lanes_.push_back(s);
+                lanePhenotypes_.push_back(phenotypes[item_[s] / episodes]);
+            }
+            laneLive_.assign(lanes_.size(), 1);
+            evaluator_.assign(lanePhenotypes_);
+            stats_.refills++;
+        }
+        stats_.ticks++;
+
+        // History, hunger and food as Game::start does them before it asks for a decision,
+        // then the sensors of every live game
+        for (size_t lane = 0; lane < lanes_.size(); ++lane) {
+            if (!laneLive_[lane]) continue;
+            const size_t s = lanes_[lane];
+            int x = headX_[s], y = headY_[s];
+            uint16_t *visits = visits_.data() + s * cells;
+
+            int entered = board.onBoard(x, y) ? board.cell(x, y) : -1;
+            pushHistory(s, entered);
+            if (entered >= 0 && ++visits[entered] == 4)
+                overVisited_[s]++;
+            if (historySize_[s] > static_cast<size_t>(length_[s]) * 10) {
+                int left = popHistory(s);
+                if (left >= 0 && visits[left]-- == 4)
+                    overVisited_[s]--;
+            }
+
+            steps_[s]++;
+            hunger_[s]++;
+            if (x == foodX_[s] && y == foodY_[s]) {
+                grow_[s]++;
+                hunger_[s] = 0;
+                // A won board ends the episode before the next decision
+                if (free_[s].empty()) {
+                    finishEpisode(lane, Game::scoreEpisode(length_[s], grow_[s], steps_[s], false), score);
+                    live--;
+                    continue;
+                }
+                auto food = Game::drawFood(free_[s], board.cols(), rng_[s]);
+                foodX_[s] = food.first;
+                foodY_[s] = food.second;
+            }
+
+            senseState(board, occupied_[s], {x, y}, {dirX_[s], dirY_[s]}, {foodX_[s], foodY_[s]},
+                       inputs_.data() + lane * SensorCount);
+        }
+
+        evaluator_.evaluate(inputs_.data(), outputs_.data(), laneLive_.data());
+
+        // Turn, then end the episode or move
+        for (size_t lane = 0; lane < lanes_.size(); ++lane) {
+            if (!laneLive_[lane]) continue;
+            const size_t s = lanes_[lane];
+            const double *out = outputs_.data() + lane * outputCount;
+            auto action = static_cast<Direction>(std::max_element(out, out + outputCount) - out);
+            int dx = dirX_[s], dy = dirY_[s];
+            if (action == Direction::Left) {
+                dirX_[s] = dy;
+                dirY_[s] = -dx;
+            } else if (action == Direction::Right) {
+                dirX_[s] = -dy;
+                dirY_[s] = dx;
+            }
+
+            bool looping = overVisited_[s] > 0;
+            bool trapped = looping && hunger_[s] > 100 * std::max(length_[s] - 2, 1);
+            bool collided = !board.onBoard(headX_[s], headY_[s]) || bodyCollided_[s];
+            if (!looping && steps_[s] < Game::MaxSteps && !collided) {
+                move(board, s);
+                continue;
+            }
+
+            finishEpisode(lane, Game::scoreEpisode(length_[s], grow_[s], steps_[s], looping && !trapped), score);
+            live--;
+        }
+    }
+}
+
+void VectorEnv::startEpisode(size_t slot, const CounterRng &stream) {
+    // Draws in Game::reset's order: start cell, direction, then the food
+    CounterRng &rng = rng_[slot];
+    rng = stream;
+    std::uniform_int_distribution<int> distX(0, cols_ - 1);
+    std::uniform_int_distribution<int> distY(0, rows_ - 1);
+    std::uniform_int_distribution<int> distDir(0, 3);
+    int x = distX(rng);
+    int y = distY(rng);
+    auto dir = Snake::getHeading(distDir(rng));
+
+    dirX_[slot] = dir.first;
+    dirY_[slot] = dir.second;
+    occupied_[slot].clear();
+    free_[slot].reset(cols_ * rows_);
+    length_[slot] = 0;
+    for (int i = 3; i >= 0; --i) pushSegment(DynamicBoard{cols_, rows_}, slot, x - i * dir.first, y - i * dir.second);
+    headX_[slot] = x;
+    headY_[slot] = y;
+
+    grow_[slot] = 0;
+    bodyCollided_[slot] = 0;
+    steps_[slot] = 0;
+    hunger_[slot] = 0;
+    overVisited_[slot] = 0;
+    const size_t board = static_cast<size_t>(cols_) * rows_;
+    std::fill(visits_.begin() + slot * board, visits_.begin() + (slot + 1) * board, 0);
+    historyStart_[slot] = 0;
+    historySize_[slot] = 0;
+
+    auto food = Game::drawFood(free_[slot], cols_, rng);
+    foodX_[slot] = food.first;
+    foodY_[slot] = food.second;
+}
+
+void VectorEnv::finishEpisode(size_t lane, double episodeScore, std::vector<double> &score) {
+    const size_t s = lanes_[lane];
+    score[item_[s]] = episodeScore;
+    stats_.steps += steps_[s];
+    stats_.episodes++;
+    item_[s] = -1;
+    laneLive_[lane] = 0;
+}
+
+void VectorEnv::pushHistory(size_t slot, int cell) {
+    size_t end = historyStart_[slot] + historySize_[slot]++;
+    if (end >= historyCapacity_) end -= historyCapacity_;
+    history_[slot * historyCapacity_ + end] = static_cast<int16_t>(cell);
+}
+
+int VectorEnv::popHistory(size_t slot) {
+    size_t &start = historyStart_[slot];
+    int cell = history_[slot * historyCapacity_ + start];
+    if (++start == historyCapacity_) start = 0;
+    historySize_[slot]--;
+    return cell;
+}
@@ -1,6 +1,8 @@
 #include "SnakeGame/Game.h"
 #include "SnakeGame/SDLInputProvider.h"
+#include "SnakeGame/NativeInputProvider.h"
 #include "Model/Model.h"
+#include "Model/NativeCodegen.h"
 #include "Model/Population.h"
 #include <iostream>
 #include <vector>
@@ -11,6 +13,7 @@
 #include <unistd.h>
 #include <cstdlib>
 #include <iostream>
+#include <fstream>
 #include <omp.h>
 
 void printStackTrace() {
@@ -53,9 +56,58 @@ void signalHandler(int signum) {
     exit(signum);
 }
 
-int main() {
+static std::unique_ptr<Model> loadModel(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "cannot open " << path << std::endl;
+        return nullptr;
+    }
+    auto model = std::make_unique<Model>(11, 3);
+    model->load(in);
+    return model;
+}
+
+// snakeapp play <fittest_gen_N.bin>: replay a saved champion through compiled native code
+static int playChampion(const std::string& path) {
+    auto model = loadModel(path);
+    if (!model) return 1;
+
+    auto provider = std::make_unique<NativeInputProvider>(model.get(), true);
+    if (!provider->isNative())
+        std::cerr << "native build unavailable, interpreting: " << provider->getError() << std::endl;
+
+    Renderer renderer(800, 800);
+    Game game(800, 800, &renderer, std::move(provider));
+    game.start(0.0);
+    std::cout << "score: " << game.getScore() << std::endl;
+    return 0;
+}
+
+// snakeapp export <fittest_gen_N.bin> [out.cpp]: write the champion as straight-line C++
+static int exportChampion(const std::string& path, const std::string& outPath) {
+    auto model = loadModel(path);
+    if (!model) return 1;
+
+    model->compile(Precision::Double);
+    if (outPath.empty()) {
+        exportNativeSource(model->getPhenotype(), std::cout);
+        return 0;
+    }
+    std::ofstream out(outPath);
+    exportNativeSource(model->getPhenotype(), out);
+    return 0;
+}
+
+int main(int argc, char** argv) {
     signal(SIGSEGV, signalHandler);
     signal(SIGABRT, signalHandler);
+
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "play" && argc > 2)
+        return playChampion(argv[2]);
+    if (command == "export" && argc > 2)
+        return exportChampion(argv[2], argc > 3 ? argv[3] : "");
+
 //    std::unique_ptr<SDLInputProvider> inputProvider = std::make_unique<SDLInputProvider>();
 //    int w = 800;
 //    int h = 800;
@@ -67,8 +119,12 @@ int main() {
 //    std::vector<double> inputs{0.4, 0.33, 0.2, 0.8};
 //    std::cout << vectorToString(model.feedForward(inputs)) << std::endl;
 
+    // snakeapp train <seed>: replay the run of an earlier seed
+    uint64_t seed = command == "train" && argc > 2 ? std::strtoull(argv[2], nullptr, 10) : randomSeed();
+    std::cout << "seed: " << seed << std::endl;
+
     Renderer renderer(800, 800);
-    Population population(5000);
+    Population population(5000, seed);
     population.train(&renderer);
     return 0;
 }